@@ -0,0 +1,215 @@
+#include <limits.h>
+#include <string.h>
+
+#include "aabb.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+// the Makefile builds for the baseline CPU, so the AVX2 kernel is compiled for
+// AVX2 on its own and only called when the CPU has it
+#if defined( __SSE2__ ) && defined( __GNUC__ )
+#define FERMI_AABB_AVX2
+#include <immintrin.h>
+#endif
+
+const char* rectKernelNames[ RECT_KERNEL_COUNT ] = { "scalar", "sse2", "avx2" };
+
+// every kernel fills whole mask words: word k covers rects [ 32k, 32k + 32 ),
+// clipped to count. With accumulate the bits are ORed into the words instead
+// of replacing them
+typedef void ( *MaskKernel )( const RectArrays& r, int count, const SDL_Rect& q, Uint32* mask, bool accumulate );
+
+namespace {
+    inline Uint32 overlapBit( const RectArrays& r, int i, int qx0, int qx1, int qy0, int qy1 )
+    {
+        // checkCollision without branches
+        return ( r.x[ i ] < qx1 ) & ( r.x[ i ] + r.w[ i ] > qx0 ) & ( r.y[ i ] < qy1 ) & ( r.y[ i ] + r.h[ i ] > qy0 );
+    }
+
+    void maskScalar( const RectArrays& r, int count, const SDL_Rect& q, Uint32* mask, bool accumulate )
+    {
+        int qx1 = q.x + q.w, qy1 = q.y + q.h;
+        for ( int base=0; base<count; base+=32 ) {
+            int n = count - base < 32 ? count - base : 32;
+            Uint32 bits = 0;
+            for ( int k=0; k<n; k++ ) {
+                bits |= overlapBit( r, base + k, q.x, qx1, q.y, qy1 ) << k;
+            }
+            mask[ base / 32 ] = accumulate ? mask[ base / 32 ] | bits : bits;
+        }
+    }
+
+    // the last, partial word of rects copied out and padded with rects that
+    // overlap nothing, so the vector kernels never read past count
+    struct PaddedWord {
+        int x[ 32 ], y[ 32 ], w[ 32 ], h[ 32 ];
+    };
+
+    RectArrays padWord( const RectArrays& r, int base, int count, PaddedWord& word )
+    {
+        int n = count - base;
+        memcpy( word.x, r.x + base, n * sizeof( int ) );
+        memcpy( word.y, r.y + base, n * sizeof( int ) );
+        memcpy( word.w, r.w + base, n * sizeof( int ) );
+        memcpy( word.h, r.h + base, n * sizeof( int ) );
+        for ( int k=n; k<32; k++ ) {
+            word.x[ k ] = word.y[ k ] = INT_MAX;
+            word.w[ k ] = word.h[ k ] = 0;
+        }
+        RectArrays padded = { word.x, word.y, word.w, word.h };
+        return padded;
+    }
+
+#ifdef __SSE2__
+    void maskSse2( const RectArrays& r, int count, const SDL_Rect& q, Uint32* mask, bool accumulate )
+    {
+        // 4 rects per step; movemask turns the lane compares into 4 bits
+        const __m128i qx0 = _mm_set1_epi32( q.x ), qx1 = _mm_set1_epi32( q.x + q.w );
+        const __m128i qy0 = _mm_set1_epi32( q.y ), qy1 = _mm_set1_epi32( q.y + q.h );
+        PaddedWord padded;
+        for ( int base=0; base<count; base+=32 ) {
+            RectArrays word = { r.x + base, r.y + base, r.w + base, r.h + base };
+            if ( count - base < 32 ) {
+                word = padWord( r, base, count, padded );
+            }
+            Uint32 bits = 0;
+            for ( int k=0; k<32; k+=4 ) {
+                __m128i x = _mm_loadu_si128( (const __m128i*)( word.x + k ) );
+                __m128i y = _mm_loadu_si128( (const __m128i*)( word.y + k ) );
+                __m128i w = _mm_loadu_si128( (const __m128i*)( word.w + k ) );
+                __m128i h = _mm_loadu_si128( (const __m128i*)( word.h + k ) );
+                __m128i in = _mm_and_si128( _mm_cmpgt_epi32( qx1, x ), _mm_cmpgt_epi32( _mm_add_epi32( x, w ), qx0 ) );
+                in = _mm_and_si128( in, _mm_cmpgt_epi32( qy1, y ) );
+                in = _mm_and_si128( in, _mm_cmpgt_epi32( _mm_add_epi32( y, h ), qy0 ) );
+                bits |= (Uint32)_mm_movemask_ps( _mm_castsi128_ps( in ) ) << k;
+            }
+            mask[ base / 32 ] = accumulate ? mask[ base / 32 ] | bits : bits;
+        }
+    }
+#endif
+
+#ifdef FERMI_AABB_AVX2
+    __attribute__(( target( "avx2" ) ))
+    void maskAvx2( const RectArrays& r, int count, const SDL_Rect& q, Uint32* mask, bool accumulate )
+    {
+        // the SSE2 kernel 8 rects wide
+        const __m256i qx0 = _mm256_set1_epi32( q.x ), qx1 = _mm256_set1_epi32( q.x + q.w );
+        const __m256i qy0 = _mm256_set1_epi32( q.y ), qy1 = _mm256_set1_epi32( q.y + q.h );
+        PaddedWord padded;
+        for ( int base=0; base<count; base+=32 ) {
+            RectArrays word = { r.x + base, r.y + base, r.w + base, r.h + base };
+            if ( count - base < 32 ) {
+                word = padWord( r, base, count, padded );
+            }
+            Uint32 bits = 0;
+            for ( int k=0; k<32; k+=8 ) {
+                __m256i x = _mm256_loadu_si256( (const __m256i*)( word.x + k ) );
+                __m256i y = _mm256_loadu_si256( (const __m256i*)( word.y + k ) );
+                __m256i w = _mm256_loadu_si256( (const __m256i*)( word.w + k ) );
+                __m256i h = _mm256_loadu_si256( (const __m256i*)( word.h + k ) );
+                __m256i in = _mm256_and_si256( _mm256_cmpgt_epi32( qx1, x ), _mm256_cmpgt_epi32( _mm256_add_epi32( x, w ), qx0 ) );
+                in = _mm256_and_si256( in, _mm256_cmpgt_epi32( qy1, y ) );
+                in = _mm256_and_si256( in, _mm256_cmpgt_epi32( _mm256_add_epi32( y, h ), qy0 ) );
+                bits |= (Uint32)_mm256_movemask_ps( _mm256_castsi256_ps( in ) ) << k;
+            }
+            mask[ base / 32 ] = accumulate ? mask[ base / 32 ] | bits : bits;
+        }
+    }
+#endif
+
+    MaskKernel maskKernel( RectKernel kernel )
+    {
+        // an unsupported kernel falls back to the scalar one
+        if ( !rectKernelSupported( kernel ) ) {
+            return maskScalar;
+        }
+        switch ( kernel ) {
+#ifdef __SSE2__
+            case RECT_KERNEL_SSE2:
+                return maskSse2;
+#endif
+#ifdef FERMI_AABB_AVX2
+            case RECT_KERNEL_AVX2:
+                return maskAvx2;
+#endif
+            default:
+                return maskScalar;
+        }
+    }
+
+    inline int lowestBit( Uint32 bits )
+    {
+#ifdef __GNUC__
+        return __builtin_ctz( bits );
+#else
+        int b = 0;
+        while ( ( bits & 1 ) == 0 ) {
+            bits >>= 1;
+            b++;
+        }
+        return b;
+#endif
+    }
+}
+
+bool rectKernelSupported( RectKernel kernel )
+{
+    switch ( kernel ) {
+        case RECT_KERNEL_SCALAR:
+            return true;
+#ifdef __SSE2__
+        case RECT_KERNEL_SSE2:
+            return true;
+#endif
+#ifdef FERMI_AABB_AVX2
+        case RECT_KERNEL_AVX2:
+            return __builtin_cpu_supports( "avx2" );
+#endif
+        default:
+            return false;
+    }
+}
+RectKernel bestRectKernel()
+{
+    static const RectKernel best = rectKernelSupported( RECT_KERNEL_AVX2 ) ? RECT_KERNEL_AVX2 :
+                                   ( rectKernelSupported( RECT_KERNEL_SSE2 ) ? RECT_KERNEL_SSE2 : RECT_KERNEL_SCALAR );
+    return best;
+}
+
+void overlapMask( const RectArrays& rects, int count, const SDL_Rect* queries, int queryCount,
+                  Uint32* mask, RectKernel kernel )
+{
+    // one pass over the rects per query, ORing into the mask after the first
+    if ( queryCount <= 0 ) {
+        for ( int k=0; k<( count + 31 ) / 32; k++ ) {
+            mask[ k ] = 0;
+        }
+        return;
+    }
+    MaskKernel run = maskKernel( kernel );
+    for ( int q=0; q<queryCount; q++ ) {
+        run( rects, count, queries[ q ], mask, q > 0 );
+    }
+}
+int overlapIndices( const RectArrays& rects, int count, const SDL_Rect& query,
+                    int* indices, RectKernel kernel )
+{
+    // masks a block of rects at a time into a buffer that stays in L1, then
+    // turns the set bits into indices
+    const int blockWords = 32;
+    Uint32 words[ blockWords ];
+    MaskKernel run = maskKernel( kernel );
+    int found = 0;
+    for ( int base=0; base<count; base+=blockWords*32 ) {
+        int n = count - base < blockWords * 32 ? count - base : blockWords * 32;
+        RectArrays block = { rects.x + base, rects.y + base, rects.w + base, rects.h + base };
+        run( block, n, query, words, false );
+        for ( int k=0; k<( n + 31 ) / 32; k++ ) {
+            for ( Uint32 bits=words[ k ]; bits!=0; bits&=bits-1 ) {
+                indices[ found++ ] = base + k * 32 + lowestBit( bits );
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,43 @@
+#ifndef FERMI_AABB_H
+#define FERMI_AABB_H
+
+#include "common.h"
+
+// Overlap tests of many rects against a query rect at once, the batch form of
+// checkCollision with the same edge rules. The rects are given as separate
+// arrays of x, y, width and height, so a vector kernel loads 4 or 8 of each
+// with one instruction. The SSE2 and AVX2 kernels are picked at run time from
+// what the CPU supports; the scalar kernel works everywhere and gives the
+// same answers
+
+enum RectKernel {
+    RECT_KERNEL_SCALAR,
+    RECT_KERNEL_SSE2,
+    RECT_KERNEL_AVX2,
+    RECT_KERNEL_COUNT
+};
+
+extern const char* rectKernelNames[ RECT_KERNEL_COUNT ];
+
+bool rectKernelSupported( RectKernel kernel );
+// the widest kernel this CPU runs, checked once
+RectKernel bestRectKernel();
+
+struct RectArrays {
+    const int* x;
+    const int* y;
+    const int* w;
+    const int* h;
+};
+
+// one bit per rect, ( count + 31 ) / 32 words with rect i at bit i % 32 of
+// word i / 32. Bit i is set when rect i overlaps any of the queries. Bits past
+// count are cleared
+void overlapMask( const RectArrays& rects, int count, const SDL_Rect* queries, int queryCount,
+                  Uint32* mask, RectKernel kernel = bestRectKernel() );
+// writes the indices of the rects overlapping query to indices in increasing
+// order and returns how many there are; indices needs room for count
+int overlapIndices( const RectArrays& rects, int count, const SDL_Rect& query,
+                    int* indices, RectKernel kernel = bestRectKernel() );
+
+#endif
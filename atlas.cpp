@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include <SDL2/SDL_image.h>
+
+#include "atlas.h"
+#include "profiler.h"
+
+struct AtlasCacheHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint64 stamp;
+    Uint32 width;
+    Uint32 height;
+    Uint32 spriteCount;
+    Uint32 reserved;
+};
+
+Uint64 atlasSourceStamp( const AtlasSheet* sheets, int sheetCount )
+{
+    // hash of every sheet's path, size, modification time and frame size.
+    // Returns 0 if a sheet is missing
+    Uint64 h = 14695981039346656037ull;
+    for ( int i=0; i<sheetCount; i++ ) {
+        struct stat st;
+        if ( stat( sheets[ i ].path, &st ) != 0 ) {
+            return 0;
+        }
+        Uint64 values[] = { (Uint64)st.st_size, (Uint64)st.st_mtime, (Uint64)sheets[ i ].frameW, (Uint64)sheets[ i ].frameH };
+        for ( const char* c=sheets[ i ].path; *c; c++ ) {
+            h = ( h ^ (Uint8)*c ) * 1099511628211ull;
+        }
+        for ( int j=0; j<4; j++ ) {
+            h = ( h ^ values[ j ] ) * 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+TextureAtlas::TextureAtlas()
+{
+    this->width = 0;
+    this->height = 0;
+    this->cached = false;
+}
+bool TextureAtlas::load( const AtlasSheet* sheets, int sheetCount, const char* cachePath )
+{
+    // use the cache if it matches the sheets on disk, otherwise decode and
+    // pack them and refresh the cache
+    PROFILE_ZONE( "load atlas" );
+    Uint64 stamp = atlasSourceStamp( sheets, sheetCount );
+    this->cached = stamp != 0 && this->loadCache( cachePath, stamp );
+    if ( this->cached ) {
+        return true;
+    }
+    if ( !this->build( sheets, sheetCount ) ) {
+        return false;
+    }
+    if ( stamp != 0 ) {
+        this->saveCache( cachePath, stamp );
+    }
+    return true;
+}
+bool TextureAtlas::build( const AtlasSheet* sheets, int sheetCount )
+{
+    // decode every sheet and cut it into frame surfaces
+    std::vector<SDL_Surface*> frames;
+    bool ok = true;
+    for ( int i=0; ok && i<sheetCount; i++ ) {
+        SDL_Surface* loaded = IMG_Load( sheets[ i ].path );
+        if ( loaded == NULL ) {
+            printf( "Unable to load image %s! SDL_image Error: %s\n", sheets[ i ].path, SDL_GetError() );
+            ok = false;
+            break;
+        }
+        SDL_Surface* sheet = SDL_ConvertSurfaceFormat( loaded, SDL_PIXELFORMAT_RGBA8888, 0 );
+        SDL_FreeSurface( loaded );
+        if ( sheet == NULL ) {
+            printf( "Unable to convert image %s! SDL Error: %s\n", sheets[ i ].path, SDL_GetError() );
+            ok = false;
+            break;
+        }
+        // the blits copy pixels as they are, alpha included
+        SDL_SetSurfaceBlendMode( sheet, SDL_BLENDMODE_NONE );
+        int frameW = sheets[ i ].frameW > 0 ? sheets[ i ].frameW : sheet->w;
+        int frameH = sheets[ i ].frameH > 0 ? sheets[ i ].frameH : sheet->h;
+        for ( int y=0; ok && y+frameH<=sheet->h; y+=frameH ) {
+            for ( int x=0; ok && x+frameW<=sheet->w; x+=frameW ) {
+                SDL_Rect src = { x, y, frameW, frameH };
+                SDL_Surface* frame = SDL_CreateRGBSurfaceWithFormat( 0, frameW, frameH, 32, SDL_PIXELFORMAT_RGBA8888 );
+                ok = frame != NULL && SDL_BlitSurface( sheet, &src, frame, NULL ) == 0;
+                if ( frame != NULL ) {
+                    frames.push_back( frame );
+                }
+            }
+        }
+        if ( !ok ) {
+            printf( "Unable to cut frames from %s! SDL Error: %s\n", sheets[ i ].path, SDL_GetError() );
+        }
+        SDL_FreeSurface( sheet );
+    }
+    ok = ok && this->pack( frames );
+    for ( size_t i=0; i<frames.size(); i++ ) {
+        SDL_FreeSurface( frames[ i ] );
+    }
+    return ok;
+}
+bool TextureAtlas::pack( const std::vector<SDL_Surface*>& frames )
+{
+    // shelf packing, tallest frames first, into the narrowest power of two
+    // width that keeps the atlas roughly square
+    const int pad = atlas_constants::padding;
+    std::vector<int> order( frames.size() );
+    long area = 0;
+    int widest = 0;
+    for ( size_t i=0; i<frames.size(); i++ ) {
+        order[ i ] = i;
+        area += (long)( frames[ i ]->w + 2*pad ) * ( frames[ i ]->h + 2*pad );
+        widest = std::max( widest, frames[ i ]->w + 2*pad );
+    }
+    std::stable_sort( order.begin(), order.end(), [&]( int a, int b ) { return frames[ a ]->h > frames[ b ]->h; } );
+    int w = 1;
+    while ( w < widest || (long)w * w < area ) {
+        w *= 2;
+    }
+
+    std::vector<SDL_Rect> placed( frames.size() );
+    int x = 0, y = 0, shelfH = 0;
+    for ( size_t i=0; i<order.size(); i++ ) {
+        SDL_Surface* frame = frames[ order[ i ] ];
+        if ( x + frame->w + 2*pad > w ) {
+            x = 0;
+            y += shelfH;
+            shelfH = 0;
+        }
+        placed[ order[ i ] ] = { x + pad, y + pad, frame->w, frame->h };
+        x += frame->w + 2*pad;
+        shelfH = std::max( shelfH, frame->h + 2*pad );
+    }
+    int h = 1;
+    while ( h < y + shelfH ) {
+        h *= 2;
+    }
+    if ( w > atlas_constants::maxSize || h > atlas_constants::maxSize ) {
+        printf( "Unable to pack atlas: %dx%d is larger than %d!\n", w, h, atlas_constants::maxSize );
+        return false;
+    }
+
+    this->width = w;
+    this->height = h;
+    this->clips = placed;
+    this->pixels.assign( (size_t)w * h, 0 );
+    for ( size_t i=0; i<frames.size(); i++ ) {
+        SDL_Surface* frame = frames[ i ];
+        for ( int row=0; row<frame->h; row++ ) {
+            const Uint8* src = (const Uint8*)frame->pixels + row * frame->pitch;
+            memcpy( &this->pixels[ (size_t)( placed[ i ].y + row ) * w + placed[ i ].x ], src, frame->w * sizeof( Uint32 ) );
+        }
+    }
+    return true;
+}
+bool TextureAtlas::loadCache( const char* path, Uint64 stamp )
+{
+    FILE* f = fopen( path, "rb" );
+    if ( f == NULL ) {
+        return false;
+    }
+    AtlasCacheHeader header;
+    bool ok = fread( &header, sizeof( header ), 1, f ) == 1 &&
+              header.magic == atlas_constants::cacheMagic &&
+              header.version == atlas_constants::cacheVersion &&
+              header.stamp == stamp &&
+              header.width <= (Uint32)atlas_constants::maxSize &&
+              header.height <= (Uint32)atlas_constants::maxSize;
+    if ( ok ) {
+        std::vector<SDL_Rect> clips( header.spriteCount );
+        std::vector<Uint32> pixels( (size_t)header.width * header.height );
+        ok = fread( clips.data(), sizeof( SDL_Rect ), clips.size(), f ) == clips.size() &&
+             fread( pixels.data(), sizeof( Uint32 ), pixels.size(), f ) == pixels.size();
+        if ( ok ) {
+            this->width = header.width;
+            this->height = header.height;
+            this->clips.swap( clips );
+            this->pixels.swap( pixels );
+        }
+    }
+    fclose( f );
+    return ok;
+}
+bool TextureAtlas::saveCache( const char* path, Uint64 stamp )
+{
+    // header, clip rects, then the pixels, all in native byte order
+    FILE* f = fopen( path, "wb" );
+    if ( f == NULL ) {
+        printf( "Unable to open %s for writing!\n", path );
+        return false;
+    }
+    AtlasCacheHeader header = { atlas_constants::cacheMagic, atlas_constants::cacheVersion, stamp,
+                                (Uint32)this->width, (Uint32)this->height, (Uint32)this->clips.size(), 0 };
+    bool ok = fwrite( &header, sizeof( header ), 1, f ) == 1 &&
+              fwrite( this->clips.data(), sizeof( SDL_Rect ), this->clips.size(), f ) == this->clips.size() &&
+              fwrite( this->pixels.data(), sizeof( Uint32 ), this->pixels.size(), f ) == this->pixels.size();
+    ok = ( fclose( f ) == 0 ) && ok;
+    if ( !ok ) {
+        printf( "Unable to write atlas cache %s!\n", path );
+        remove( path );
+    }
+    return ok;
+}
+SDL_Texture* TextureAtlas::createTexture( SDL_Renderer* renderer )
+{
+    // upload the packed image. Return NULL on failure
+    SDL_Texture* texture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, this->width, this->height );
+    if ( texture == NULL ) {
+        printf( "Unable to create atlas texture! SDL Error: %s\n", SDL_GetError() );
+        return NULL;
+    }
+    SDL_SetTextureBlendMode( texture, SDL_BLENDMODE_BLEND );
+    if ( SDL_UpdateTexture( texture, NULL, this->pixels.data(), this->width * sizeof( Uint32 ) ) != 0 ) {
+        printf( "Unable to upload atlas texture! SDL Error: %s\n", SDL_GetError() );
+        SDL_DestroyTexture( texture );
+        return NULL;
+    }
+    return texture;
+}
+Uint32 TextureAtlas::averageColor( int sprite )
+{
+    // mean of every channel over the sprite, in SDL_PIXELFORMAT_RGBA8888
+    const SDL_Rect& clip = this->clips[ sprite ];
+    Uint64 sum[ 4 ] = { 0, 0, 0, 0 };
+    for ( int y=clip.y; y<clip.y+clip.h; y++ ) {
+        for ( int x=clip.x; x<clip.x+clip.w; x++ ) {
+            Uint32 p = this->pixels[ (size_t)y * this->width + x ];
+            for ( int c=0; c<4; c++ ) {
+                sum[ c ] += ( p >> ( 24 - 8*c ) ) & 0xFF;
+            }
+        }
+    }
+    Uint64 count = std::max( 1, clip.w * clip.h );
+    Uint32 color = 0;
+    for ( int c=0; c<4; c++ ) {
+        color |= (Uint32)( sum[ c ] / count ) << ( 24 - 8*c );
+    }
+    return color;
+}
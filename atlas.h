@@ -0,0 +1,59 @@
+#ifndef FERMI_ATLAS_H
+#define FERMI_ATLAS_H
+
+#include <vector>
+
+#include "common.h"
+
+namespace atlas_constants {
+    // "FPAT", bump the version when the cache layout changes
+    const Uint32 cacheMagic = 0x54415046;
+    const Uint32 cacheVersion = 1;
+    // transparent pixels kept around every sprite so filtering never samples a neighbour
+    const int padding = 1;
+    const int maxSize = 4096;
+};
+
+// A sprite sheet fed into the atlas. The sheet is cut into frames of
+// frameW x frameH in row-major order; a frame size of 0 keeps the whole image
+// as one sprite
+struct AtlasSheet {
+    const char* path;
+    int frameW;
+    int frameH;
+};
+
+// Every sprite of a list of sheets packed into one RGBA8888 image, so all of
+// them are drawn from a single texture. Sprites are numbered in sheet order,
+// then frame order, and clip() gives their rect in the atlas. The packed image
+// can be written to a raw cache file that later starts load instead of
+// decoding the PNGs; the cache is rebuilt when a sheet changes on disk.
+class TextureAtlas {
+public:
+    TextureAtlas();
+    bool load( const AtlasSheet* sheets, int sheetCount, const char* cachePath );
+    bool build( const AtlasSheet* sheets, int sheetCount );
+    bool loadCache( const char* path, Uint64 stamp );
+    bool saveCache( const char* path, Uint64 stamp );
+    SDL_Texture* createTexture( SDL_Renderer* renderer );
+    Uint32 averageColor( int sprite );
+
+    int spriteCount() { return this->clips.size(); };
+    const SDL_Rect& clip( int sprite ) { return this->clips[ sprite ]; };
+    int getWidth() { return this->width; };
+    int getHeight() { return this->height; };
+    // true if the last load() was served from the cache
+    bool fromCache() { return this->cached; };
+private:
+    bool pack( const std::vector<SDL_Surface*>& frames );
+
+    int width;
+    int height;
+    std::vector<Uint32> pixels;
+    std::vector<SDL_Rect> clips;
+    bool cached;
+};
+
+Uint64 atlasSourceStamp( const AtlasSheet* sheets, int sheetCount );
+
+#endif
@@ -0,0 +1,631 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <thread>
+
+#include <SDL2/SDL.h>
+
+#include "common.h"
+#include "tile.h"
+#include "worldfile.h"
+#include "terrain.h"
+#include "lod.h"
+#include "jobs.h"
+#include "entities.h"
+#include "aabb.h"
+#include "tilesim.h"
+
+// globals the engine expects from its front-end. Nothing here draws, so the
+// renderer and textures stay NULL
+SDL_Rect gTileClips[ TILE_COUNT ];
+Uint32 gTileColors[ TILE_COUNT ];
+SDL_Renderer* gRenderer = NULL;
+SDL_Texture* gTileTexture = NULL;
+int gDrawCalls = 0;
+int gTilesDrawn = 0;
+
+// one object per tile with its rect, the layout the packed Chunk replaced.
+// Only kept here to compare against
+class Tile {
+public:
+    Tile( int x, int y, int type )
+    {
+        this->rect.x = x;
+        this->rect.y = y;
+        this->rect.w = TILE_W;
+        this->rect.h = TILE_H;
+        this->type = type;
+    }
+
+    int getType() { return this->type; };
+    SDL_Rect& getRect() { return this->rect; };
+private:
+    int type;
+    SDL_Rect rect;
+};
+
+double secondsSince( Uint64 start )
+{
+    return ( SDL_GetPerformanceCounter() - start ) / (double)SDL_GetPerformanceFrequency();
+}
+
+bool benchTiles()
+{
+    // compare the old array of Tile objects against the compact Chunk layout:
+    // memory per chunk and the throughput of two full scans in Mtiles/s. The
+    // cull scan tests every tile rect against a view covering the middle of the
+    // chunk, the type scan only counts metal tiles. Returns false if the two
+    // layouts disagree
+    bool ok = true;
+    const long tilesPerSize = 64L * 1024 * 1024;
+    printf( "%8s %12s %12s %10s %10s %10s %10s\n", "length", "Tile bytes", "Chunk bytes",
+            "Tile cull", "Chunk cull", "Tile type", "Chunk type" );
+    for ( int length=64; length<=4096; length*=2 ) {
+        long tiles = (long)length * length;
+        int reps = std::max( 1L, tilesPerSize / tiles );
+
+        std::vector<Tile> tileList;
+        tileList.reserve( tiles );
+        Chunk chunk( length );
+        std::minstd_rand rng( length );
+        for ( int i=0; i<length; i++ ) {
+            for ( int j=0; j<length; j++ ) {
+                int type = rng()%2;
+                tileList.push_back( Tile( j * TILE_W, i * TILE_H, type ) );
+                chunk.setType( i, j, type );
+            }
+        }
+        SDL_Rect view = { length * TILE_W / 4, length * TILE_H / 4, length * TILE_W / 2, length * TILE_H / 2 };
+
+        long tileCount = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for ( int r=0; r<reps; r++ ) {
+            for ( long i=0; i<tiles; i++ ) {
+                if ( checkCollision( tileList[ i ].getRect(), view ) && tileList[ i ].getType() == TILE_METAL ) {
+                    tileCount++;
+                }
+            }
+        }
+        double tileTime = secondsSince( start );
+
+        long chunkCount = 0;
+        start = SDL_GetPerformanceCounter();
+        for ( int r=0; r<reps; r++ ) {
+            const Uint8* types = chunk.data();
+            for ( int i=0; i<length; i++ ) {
+                for ( int j=0; j<length; j++ ) {
+                    if ( checkCollision( chunk.tileRect( i, j ), view ) && types[ i*length + j ] == TILE_METAL ) {
+                        chunkCount++;
+                    }
+                }
+            }
+        }
+        double chunkTime = secondsSince( start );
+
+        long tileTypeCount = 0;
+        start = SDL_GetPerformanceCounter();
+        for ( int r=0; r<reps; r++ ) {
+            for ( long i=0; i<tiles; i++ ) {
+                tileTypeCount += tileList[ i ].getType() == TILE_METAL;
+            }
+        }
+        double tileTypeTime = secondsSince( start );
+
+        long chunkTypeCount = 0;
+        start = SDL_GetPerformanceCounter();
+        for ( int r=0; r<reps; r++ ) {
+            const Uint8* types = chunk.data();
+            for ( long i=0; i<tiles; i++ ) {
+                chunkTypeCount += types[ i ] == TILE_METAL;
+            }
+        }
+        double chunkTypeTime = secondsSince( start );
+
+        if ( tileCount != chunkCount || tileTypeCount != chunkTypeCount ) {
+            printf( "Mismatch at length %d\n", length );
+            ok = false;
+        }
+        printf( "%8d %12zu %12zu %10.1f %10.1f %10.1f %10.1f\n", length,
+                sizeof( tileList ) + tiles * sizeof( Tile ), chunk.bytes(),
+                tiles * reps / tileTime / 1e6, tiles * reps / chunkTime / 1e6,
+                tiles * reps / tileTypeTime / 1e6, tiles * reps / chunkTypeTime / 1e6 );
+    }
+    return ok;
+}
+
+bool benchWorldFile()
+{
+    // save worlds of growing size, then time opening them and reading one
+    // chunk. Opening maps the file, so it should not grow with the world. Every
+    // chunk is read back and compared with what was saved
+    bool ok = true;
+    const int length = 64;
+    const char* path = "bench_world.tmp";
+    printf( "%8s %10s %10s %10s %12s %10s\n", "chunks", "file MB", "save ms", "open ms", "read one us", "round trip" );
+    for ( int side=4; side<=64; side*=4 ) {
+        std::vector<Chunk> chunks;
+        chunks.reserve( side * side );
+        WorldFileWriter writer( length );
+        Uint64 start = SDL_GetPerformanceCounter();
+        for ( int cy=0; cy<side; cy++ ) {
+            for ( int cx=0; cx<side; cx++ ) {
+                chunks.push_back( Chunk( length, cx * length * TILE_W, cy * length * TILE_H ) );
+                // every other chunk is uniform so both record encodings are covered
+                if ( ( cx + cy ) % 2 == 0 ) {
+                    loadChunk( chunks.back(), cy * side + cx );
+                }
+                writer.add( { cx, cy }, chunks.back().data() );
+            }
+        }
+        bool saved = writer.write( path );
+        double saveMs = secondsSince( start ) * 1000.0;
+
+        WorldFile file;
+        start = SDL_GetPerformanceCounter();
+        bool opened = saved && file.open( path );
+        double openMs = secondsSince( start ) * 1000.0;
+
+        Chunk chunk( length );
+        start = SDL_GetPerformanceCounter();
+        bool readOne = opened && file.readChunk( { side / 2, side / 2 }, chunk );
+        double readUs = secondsSince( start ) * 1e6;
+
+        bool same = readOne;
+        for ( int i=0; same && i<side*side; i++ ) {
+            same = file.readChunk( { i % side, i / side }, chunk ) &&
+                   memcmp( chunk.data(), chunks[ i ].data(), length * length ) == 0;
+        }
+        same = same && !file.readChunk( { side, side }, chunk );
+
+        struct stat st;
+        double fileMB = stat( path, &st ) == 0 ? st.st_size / ( 1024.0 * 1024.0 ) : 0.0;
+        printf( "%8d %10.2f %10.2f %10.3f %12.2f %10s\n", side * side, fileMB, saveMs, openMs, readUs, same ? "ok" : "FAILED" );
+        file.close();
+        remove( path );
+        ok = ok && same;
+    }
+    return ok;
+}
+
+bool benchTerrain()
+{
+    // terrain generation throughput in Mtiles/s for the scalar reference and
+    // the SIMD kernel. The determinism column checks that both agree, that a
+    // second generator with the same seed rebuilds the chunk, and that a chunk
+    // matches the same area cut out of a bigger chunk generated in one piece
+    bool ok = true;
+    const long tilesPerSize = 64L * 1024 * 1024;
+    const Uint32 seed = 1234;
+    TerrainGenerator terrain( seed );
+    printf( "%8s %12s %12s %8s %14s\n", "length", "scalar", "simd", "metal %", "deterministic" );
+    for ( int length=16; length<=1024; length*=4 ) {
+        long tiles = (long)length * length;
+        int reps = std::max( 1L, tilesPerSize / tiles );
+        Chunk scalar( length );
+        Chunk simd( length );
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for ( int r=0; r<reps; r++ ) {
+            terrain.generateScalar( scalar, r * length, -r * length );
+        }
+        double scalarTime = secondsSince( start );
+
+        start = SDL_GetPerformanceCounter();
+        for ( int r=0; r<reps; r++ ) {
+            terrain.generate( simd, r * length, -r * length );
+        }
+        double simdTime = secondsSince( start );
+
+        // both loops ended on the same chunk
+        bool same = memcmp( scalar.data(), simd.data(), tiles ) == 0;
+        long metal = std::count( simd.data(), simd.data() + tiles, (Uint8)TILE_METAL );
+
+        // odd offsets and lengths exercise negative coordinates and the scalar tail
+        Chunk other( length - 1 );
+        TerrainGenerator again( seed );
+        again.generate( other, -7, -3 );
+        Chunk whole( length + 8 );
+        terrain.generate( whole, -8, -8 );
+        for ( int i=0; same && i<other.length(); i++ ) {
+            for ( int j=0; same && j<other.length(); j++ ) {
+                same = other.getType( i, j ) == whole.getType( i + 5, j + 1 ) &&
+                       other.getType( i, j ) == terrain.tileAt( j - 7, i - 3 );
+            }
+        }
+
+        printf( "%8d %12.1f %12.1f %8.1f %14s\n", length, tiles * reps / scalarTime / 1e6,
+                tiles * reps / simdTime / 1e6, 100.0 * metal / tiles, same ? "ok" : "FAILED" );
+        ok = ok && same;
+    }
+    return ok;
+}
+
+bool benchJobs()
+{
+    // build a fixed set of chunks the way the world streams them: a generate
+    // job per chunk that spawns its LOD bake and record encoding as follow-up
+    // jobs. Reports throughput and speedup from one worker to one per core,
+    // the jobs workers stole from each other and the jobs the waiting thread
+    // ran while it helped. The check column compares every chunk with the
+    // scalar generator, its LOD pixels and decoded record with the chunk, and
+    // the jobs run with three per chunk
+    const int length = 64;
+    const int side = 32;
+    const int chunkCount = side * side;
+    TerrainGenerator terrain( 1 );
+    int cores = std::max( 1, (int)std::thread::hardware_concurrency() );
+    std::vector<int> threadCounts;
+    for ( int threads=1; threads<cores; threads*=2 ) {
+        threadCounts.push_back( threads );
+    }
+    threadCounts.push_back( cores );
+    // distinct colors, so a LOD baked from the wrong tiles shows
+    gTileColors[ TILE_GRASS ] = 0x00FF00FF;
+    gTileColors[ TILE_METAL ] = 0x808080FF;
+    bool ok = true;
+    double baseRate = 0.0;
+    printf( "%8s %12s %10s %10s %10s %10s %7s\n", "workers", "chunks/s", "speedup", "jobs", "stolen", "helped", "check" );
+    for ( size_t t=0; t<threadCounts.size(); t++ ) {
+        int threads = threadCounts[ t ];
+        std::vector<std::unique_ptr<Chunk>> chunks( chunkCount );
+        std::vector<std::unique_ptr<ChunkLod>> lods( chunkCount );
+        std::vector<std::vector<Uint8>> records( chunkCount );
+        std::vector<Uint32> encodings( chunkCount );
+        JobSystem jobs( threads );
+        JobGroup group;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for ( int i=0; i<chunkCount; i++ ) {
+            jobs.submit( [&, i]() {
+                int cx = i % side, cy = i / side;
+                chunks[ i ].reset( new Chunk( length, cx * length * TILE_W, cy * length * TILE_H ) );
+                terrain.generate( *chunks[ i ], cx * length, cy * length );
+                jobs.submit( [&, i]() {
+                    lods[ i ].reset( new ChunkLod( length ) );
+                    lods[ i ]->bake( *chunks[ i ] );
+                }, &group );
+                jobs.submit( [&, i]() {
+                    encodings[ i ] = encodeChunkRecord( chunks[ i ]->data(), length, records[ i ] );
+                }, &group );
+            }, &group );
+        }
+        jobs.wait( group );
+        double rate = chunkCount / secondsSince( start );
+        if ( t == 0 ) {
+            baseRate = rate;
+        }
+        JobStats stats = jobs.stats();
+
+        bool same = stats.executed == 3L * chunkCount;
+        Chunk expected( length );
+        Chunk decoded( length );
+        for ( int i=0; same && i<chunkCount; i++ ) {
+            same = chunks[ i ] != NULL && lods[ i ] != NULL;
+            if ( !same ) {
+                break;
+            }
+            terrain.generateScalar( expected, ( i % side ) * length, ( i / side ) * length );
+            same = memcmp( chunks[ i ]->data(), expected.data(), length * length ) == 0 &&
+                   decodeChunkRecord( records[ i ].data(), records[ i ].size(), encodings[ i ], decoded.data(), length ) &&
+                   memcmp( decoded.data(), expected.data(), length * length ) == 0;
+            const Uint32* pixels = lods[ i ]->data();
+            for ( int p=0; same && p<length*length; p++ ) {
+                same = pixels[ p ] == gTileColors[ expected.data()[ p ] ];
+            }
+        }
+        printf( "%8d %12.0f %10.2f %10ld %10ld %10ld %7s\n", threads, rate, rate / baseRate, stats.executed, stats.stolen,
+                stats.helped, same ? "ok" : "FAILED" );
+        ok = ok && same;
+    }
+    return ok;
+}
+
+bool benchSim()
+{
+    // tile dynamics over a square of generated chunks, the same steps from the
+    // same tiles with 1 worker up to one per core. Reports the cost of a step
+    // per chunk, throughput and speedup over one worker. The tiles after the
+    // last step must be the same for every worker count, and the entities
+    // moved with the workers must match the ones moved on one thread
+    const int length = 64;
+    const int side = 32;
+    const int steps = 20;
+    const int entityCount = 1000000;
+    TerrainGenerator terrain( 1 );
+    std::vector<Uint8> start( side * side * length * length );
+    for ( int i=0; i<side*side; i++ ) {
+        Chunk chunk( length );
+        terrain.generate( chunk, ( i % side ) * length, ( i / side ) * length );
+        memcpy( start.data() + i * length * length, chunk.data(), length * length );
+    }
+    EntityWorld serialEntities;
+    serialEntities.spawn( entityCount, 1 );
+    Uint64 begin = SDL_GetPerformanceCounter();
+    for ( int s=0; s<steps; s++ ) {
+        serialEntities.tick();
+    }
+    double serialEntityMs = secondsSince( begin ) * 1000.0 / steps;
+
+    // at least 4 workers, so the results are compared across worker counts
+    // even on a machine with fewer cores
+    int cores = std::max( 4, (int)std::thread::hardware_concurrency() );
+    std::vector<int> threadCounts;
+    for ( int threads=1; threads<cores; threads*=2 ) {
+        threadCounts.push_back( threads );
+    }
+    threadCounts.push_back( cores );
+    bool ok = true;
+    double baseMs = 0.0;
+    std::vector<Uint8> firstResult;
+    printf( "%d chunks of %dx%d tiles, %d steps; %d entities, %.2f ms a tick on one thread\n",
+            side * side, length, length, steps, entityCount, serialEntityMs );
+    printf( "%8s %10s %12s %10s %10s %12s %13s %14s\n", "workers", "step ms", "us/chunk", "Mtiles/s",
+            "speedup", "changed", "entity ms", "deterministic" );
+    for ( size_t t=0; t<threadCounts.size(); t++ ) {
+        int threads = threadCounts[ t ];
+        std::vector<std::unique_ptr<Chunk>> chunks( side * side );
+        for ( int i=0; i<side*side; i++ ) {
+            chunks[ i ].reset( new Chunk( length, ( i % side ) * length * TILE_W, ( i / side ) * length * TILE_H ) );
+            memcpy( chunks[ i ]->data(), start.data() + i * length * length, length * length );
+        }
+        std::vector<SimChunk> sims( side * side );
+        for ( int i=0; i<side*side; i++ ) {
+            int cx = i % side, cy = i / side;
+            for ( int dy=0; dy<3; dy++ ) {
+                for ( int dx=0; dx<3; dx++ ) {
+                    int nx = cx + dx - 1, ny = cy + dy - 1;
+                    bool inside = nx >= 0 && nx < side && ny >= 0 && ny < side;
+                    sims[ i ].neighbours[ dy ][ dx ] = inside ? chunks[ ny * side + nx ].get() : NULL;
+                }
+            }
+        }
+        JobSystem jobs( threads );
+        TileSimulation sim( 1 );
+        long changed = 0;
+        begin = SDL_GetPerformanceCounter();
+        for ( int s=0; s<steps; s++ ) {
+            sim.step( sims, jobs );
+            changed += sim.stats().tilesChanged;
+        }
+        double stepMs = secondsSince( begin ) * 1000.0 / steps;
+
+        EntityWorld entities;
+        entities.spawn( entityCount, 1 );
+        begin = SDL_GetPerformanceCounter();
+        for ( int s=0; s<steps; s++ ) {
+            entities.tick( &jobs );
+        }
+        double entityMs = secondsSince( begin ) * 1000.0 / steps;
+        bool same = true;
+        for ( int i=0; i<entityCount; i++ ) {
+            SDL_Rect a = entities.rect( i ), b = serialEntities.rect( i );
+            same = same && a.x == b.x && a.y == b.y;
+        }
+
+        std::vector<Uint8> result( start.size() );
+        for ( int i=0; i<side*side; i++ ) {
+            memcpy( result.data() + i * length * length, chunks[ i ]->data(), length * length );
+        }
+        if ( t == 0 ) {
+            baseMs = stepMs;
+            firstResult = result;
+        }
+        same = same && result == firstResult;
+        ok = ok && same;
+        printf( "%8d %10.2f %12.2f %10.1f %10.2f %12ld %13.2f %14s\n", threads, stepMs, stepMs * 1000.0 / ( side * side ),
+                (double)side * side * length * length / stepMs / 1000.0, baseMs / stepMs, changed, entityMs, same ? "ok" : "FAILED" );
+    }
+    return ok;
+}
+
+bool benchEntities()
+{
+    // entities moving about a square world at constant density. Times a tick
+    // (integration plus rebuilding the spatial hash), a 1280x720 view query
+    // against scanning every entity, and the broad phase against testing every
+    // pair. The all pairs test is only run up to naiveLimit entities; the
+    // check column compares both answers wherever both ran
+    const int naiveLimit = 20000;
+    bool ok = true;
+    printf( "%9s %9s %10s %10s %8s %10s %9s %10s %7s\n", "entities", "tick ms", "query us", "scan us",
+            "visible", "pairs ms", "pairs", "naive ms", "check" );
+    for ( int count=10000; count<=1000000; count*=10 ) {
+        EntityWorld entities;
+        entities.spawn( count, count );
+        const int ticks = 10;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for ( int t=0; t<ticks; t++ ) {
+            entities.tick();
+        }
+        double tickMs = secondsSince( start ) * 1000.0 / ticks;
+
+        SDL_Rect view = { -SCREEN_WIDTH / 2, -SCREEN_HEIGHT / 2, SCREEN_WIDTH, SCREEN_HEIGHT };
+        std::vector<int> found;
+        const int queries = 100;
+        start = SDL_GetPerformanceCounter();
+        for ( int q=0; q<queries; q++ ) {
+            entities.query( view, found );
+        }
+        double queryUs = secondsSince( start ) * 1e6 / queries;
+        long scanned = 0;
+        start = SDL_GetPerformanceCounter();
+        for ( int q=0; q<queries; q++ ) {
+            scanned = 0;
+            for ( int i=0; i<entities.size(); i++ ) {
+                scanned += checkCollision( entities.rect( i ), view );
+            }
+        }
+        double scanUs = secondsSince( start ) * 1e6 / queries;
+        bool same = (long)found.size() == scanned;
+
+        std::vector<EntityPair> pairs;
+        start = SDL_GetPerformanceCounter();
+        entities.findPairs( pairs );
+        double pairsMs = secondsSince( start ) * 1000.0;
+        char naive[ 16 ] = "-";
+        if ( count <= naiveLimit ) {
+            long naivePairs = 0;
+            start = SDL_GetPerformanceCounter();
+            for ( int i=0; i<entities.size(); i++ ) {
+                SDL_Rect a = entities.rect( i );
+                for ( int j=i+1; j<entities.size(); j++ ) {
+                    naivePairs += checkCollision( a, entities.rect( j ) );
+                }
+            }
+            snprintf( naive, sizeof( naive ), "%.1f", secondsSince( start ) * 1000.0 );
+            same = same && naivePairs == (long)pairs.size();
+        }
+        printf( "%9d %9.2f %10.1f %10.1f %8zu %10.2f %9zu %10s %7s\n", count, tickMs, queryUs, scanUs,
+                found.size(), pairsMs, pairs.size(), naive, same ? "ok" : "FAILED" );
+        ok = ok && same;
+    }
+    return ok;
+}
+
+bool benchAabb()
+{
+    // batch overlap tests over entity rects, against one checkCollision call
+    // per rect. Queries are a 1280x720 view, which few rects overlap, a
+    // quarter of the world, which many do, and four views at once, which only
+    // the mask output takes. Throughput in Mrects/s, each rect tested against
+    // all of the row's queries, for every kernel the CPU supports; check
+    // compares every answer with the per call loop
+    bool ok = true;
+    const long testsPerRow = 64L * 1024 * 1024;
+    printf( "%9s %8s %8s", "rects", "query", "output" );
+    printf( " %9s", "per call" );
+    for ( int k=0; k<RECT_KERNEL_COUNT; k++ ) {
+        printf( " %9s", rectKernelNames[ k ] );
+    }
+    printf( " %8s %7s\n", "hits", "check" );
+    for ( int count=10000; count<=1000000; count*=100 ) {
+        EntityWorld entities;
+        entities.spawn( count, count );
+        RectArrays rects = { entities.rectX(), entities.rectY(), entities.rectW(), entities.rectH() };
+        int side = sqrt( (double)count ) * 64;
+        SDL_Rect views[ 4 ];
+        for ( int v=0; v<4; v++ ) {
+            views[ v ] = { ( v % 2 ) * side / 4 - side / 4, ( v / 2 ) * side / 4 - side / 4, SCREEN_WIDTH, SCREEN_HEIGHT };
+        }
+        SDL_Rect quarter = { -side / 4, -side / 4, side / 2, side / 2 };
+        int reps = std::max( 1L, testsPerRow / count );
+        int words = ( count + 31 ) / 32;
+        std::vector<Uint32> wantMask( words ), mask( words );
+        std::vector<int> wantIndices( count ), indices( count );
+
+        // each row runs one set of queries into one kind of output
+        struct {
+            const char* name;
+            const SDL_Rect* queries;
+            int queryCount;
+            bool asMask;
+        } rows[ 5 ] = {
+            { "view", views, 1, false },
+            { "quarter", &quarter, 1, false },
+            { "view", views, 1, true },
+            { "quarter", &quarter, 1, true },
+            { "4 views", views, 4, true },
+        };
+        for ( int row=0; row<5; row++ ) {
+            const SDL_Rect* queries = rows[ row ].queries;
+            int queryCount = rows[ row ].queryCount;
+            bool asMask = rows[ row ].asMask;
+            int hits = 0;
+            Uint64 start = SDL_GetPerformanceCounter();
+            for ( int r=0; r<reps; r++ ) {
+                hits = 0;
+                if ( asMask ) {
+                    std::fill( wantMask.begin(), wantMask.end(), 0 );
+                }
+                for ( int i=0; i<count; i++ ) {
+                    SDL_Rect rect = { rects.x[ i ], rects.y[ i ], rects.w[ i ], rects.h[ i ] };
+                    bool in = false;
+                    for ( int q=0; q<queryCount; q++ ) {
+                        in = in || checkCollision( rect, queries[ q ] );
+                    }
+                    if ( in && asMask ) {
+                        wantMask[ i / 32 ] |= 1u << ( i % 32 );
+                    }
+                    else if ( in ) {
+                        wantIndices[ hits ] = i;
+                    }
+                    hits += in;
+                }
+            }
+            double callRate = (double)count * reps / secondsSince( start ) / 1e6;
+            printf( "%9d %8s %8s %9.1f", count, rows[ row ].name, asMask ? "mask" : "indices", callRate );
+            bool same = true;
+            for ( int k=0; k<RECT_KERNEL_COUNT; k++ ) {
+                if ( !rectKernelSupported( (RectKernel)k ) ) {
+                    printf( " %9s", "-" );
+                    continue;
+                }
+                int found = 0;
+                start = SDL_GetPerformanceCounter();
+                for ( int r=0; r<reps; r++ ) {
+                    if ( asMask ) {
+                        overlapMask( rects, count, queries, queryCount, mask.data(), (RectKernel)k );
+                    }
+                    else {
+                        found = overlapIndices( rects, count, *queries, indices.data(), (RectKernel)k );
+                    }
+                }
+                printf( " %9.1f", (double)count * reps / secondsSince( start ) / 1e6 );
+                if ( asMask ) {
+                    same = same && std::equal( mask.begin(), mask.end(), wantMask.begin() );
+                }
+                else {
+                    same = same && found == hits && std::equal( indices.begin(), indices.begin() + found, wantIndices.begin() );
+                }
+            }
+            printf( " %8d %7s\n", hits, same ? "ok" : "FAILED" );
+            ok = ok && same;
+        }
+    }
+    return ok;
+}
+
+int main( int argc, char* argv[] )
+{
+    // microbenchmarks for the engine's hot loops: bench <name>. Exits with 2
+    // if a benchmark that checks its results finds a mismatch
+    std::string name = argc > 1 ? argv[ 1 ] : "";
+    bool ok = true;
+    if ( name == "tiles" ) {
+        ok = benchTiles();
+    }
+    else if ( name == "world" ) {
+        ok = benchWorldFile();
+    }
+    else if ( name == "terrain" ) {
+        ok = benchTerrain();
+    }
+    else if ( name == "jobs" ) {
+        ok = benchJobs();
+    }
+    else if ( name == "entities" ) {
+        ok = benchEntities();
+    }
+    else if ( name == "sim" ) {
+        ok = benchSim();
+    }
+    else if ( name == "aabb" ) {
+        ok = benchAabb();
+    }
+    else {
+        printf( "Usage: %s <benchmark>\n", argv[ 0 ] );
+        printf( "  tiles    Tile array vs compact chunk layout\n" );
+        printf( "  world    world file save, open and chunk read round trip\n" );
+        printf( "  terrain  seeded terrain generation, scalar vs SIMD\n" );
+        printf( "  jobs     chunk building on the job system, 1 to N threads\n" );
+        printf( "  entities entity tick, view query and broad phase on the spatial hash\n" );
+        printf( "  sim      tile simulation and entity ticks on 1 to N workers\n" );
+        printf( "  aabb     batch rect overlap kernels vs one checkCollision per rect\n" );
+        return 1;
+    }
+    return ok ? 0 : 2;
+}
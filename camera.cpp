@@ -0,0 +1,90 @@
+#include <algorithm>
+
+#include "camera.h"
+
+Camera::Camera( int w, int h )
+{
+    this->camTexture = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT );
+    this->box.x = 0;
+    this->box.y = 0;
+    this->box.w = w;
+    this->box.h = h;
+    this->screenW = w;
+    this->screenH = h;
+    this->pos = vec2( 0.0, 0.0 );
+    this->prevPos = this->pos;
+    this->velX = 0;
+    this->velY = 0;
+    this->camSpeed = 8.0;
+    this->zoom = 1.0;
+}
+Camera::~Camera()
+{
+    this->release();
+}
+void Camera::release()
+{
+    // before SDL_Quit, like every texture
+    if ( this->camTexture != NULL ) {
+        SDL_DestroyTexture( this->camTexture );
+        this->camTexture = NULL;
+    }
+}
+void Camera::applyInput( const InputSnapshot& input )
+{
+    // pan while arrow keys are held; opposite keys cancel out
+    this->velX = input.moveX() * this->camSpeed;
+    this->velY = input.moveY() * this->camSpeed;
+}
+void Camera::zoomBy( int steps )
+{
+    // positive steps zoom in, one step per mouse wheel notch
+    this->setZoom( this->zoom + steps * camera_constants::zoomStep );
+}
+void Camera::setZoom( double zoom )
+{
+    // zoom only changes how much of the world is in view; tiles are scaled at
+    // draw time, so this is O(1) whatever the size of the world
+    zoom = std::max( camera_constants::minZoom, std::min( camera_constants::maxZoom, zoom ) );
+
+    // keep the center of the view in place
+    vec2 center = this->pos + vec2( this->box.w / 2.0, this->box.h / 2.0 );
+    this->box.w = round( this->screenW / zoom );
+    this->box.h = round( this->screenH / zoom );
+    vec2 shift = center - vec2( this->box.w / 2.0, this->box.h / 2.0 ) - this->pos;
+    this->pos = this->pos + shift;
+    this->prevPos = this->prevPos + shift;
+    this->box.x = round( this->pos.x );
+    this->box.y = round( this->pos.y );
+
+    // keep the on-screen panning speed constant
+    double newSpeed = camera_constants::baseCamSpeed / zoom;
+    this->velX *= newSpeed / this->camSpeed;
+    this->velY *= newSpeed / this->camSpeed;
+    this->camSpeed = newSpeed;
+    this->zoom = zoom;
+}
+void Camera::move()
+{
+    this->prevPos = this->pos;
+    this->pos.x += this->velX;
+    this->pos.y += this->velY;
+    this->box.x = round( this->pos.x );
+    this->box.y = round( this->pos.y );
+}
+void Camera::screenToTile( int screenX, int screenY, int& tileX, int& tileY )
+{
+    // world tile under a screen pixel. The box is drawn scaled by zoom, so a
+    // screen pixel covers 1 / zoom world pixels
+    int worldX = floor( this->box.x + screenX / this->zoom );
+    int worldY = floor( this->box.y + screenY / this->zoom );
+    tileX = floorDiv( worldX, TILE_W );
+    tileY = floorDiv( worldY, TILE_H );
+}
+void Camera::interpolate( double alpha )
+{
+    // place the box between the last two ticks; alpha is the fraction of a tick
+    // elapsed since the last move()
+    this->box.x = round( this->prevPos.x + ( this->pos.x - this->prevPos.x ) * alpha );
+    this->box.y = round( this->prevPos.y + ( this->pos.y - this->prevPos.y ) * alpha );
+}
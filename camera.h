@@ -0,0 +1,44 @@
+#ifndef FERMI_CAMERA_H
+#define FERMI_CAMERA_H
+
+#include "common.h"
+#include "input.h"
+
+namespace camera_constants {
+    const double baseCamSpeed = 8.0;
+    const double zoomStep = 0.025;
+    const double minZoom = 0.025;
+    const double maxZoom = 1.0;
+};
+
+class Camera {
+public:
+    Camera( int w, int h );
+    ~Camera();
+    void release();
+    void applyInput( const InputSnapshot& input );
+    void zoomBy( int steps );
+    void move();
+    void interpolate( double alpha );
+    void setZoom( double zoom );
+    void screenToTile( int screenX, int screenY, int& tileX, int& tileY );
+
+    vec2 getPos() { return this->pos; };
+    double getZoom() { return this->zoom; };
+    SDL_Rect& rect() { return this->box; };
+    SDL_Texture* texture() { return camTexture; };
+private:
+    SDL_Texture* camTexture;
+    double camSpeed;
+    // the part of the world in view, in world pixels. The screen shows it
+    // scaled by zoom, so its size is the screen size divided by zoom
+    SDL_Rect box;
+    int screenW, screenH;
+    vec2 pos;
+    // position before the last move(), used to interpolate between ticks
+    vec2 prevPos;
+    double velX, velY;
+    double zoom;
+};
+
+#endif
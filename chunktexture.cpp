@@ -0,0 +1,106 @@
+#include <algorithm>
+
+#include "chunktexture.h"
+
+ChunkTexture::ChunkTexture()
+{
+    this->texture = NULL;
+    this->valid = false;
+}
+ChunkTexture::~ChunkTexture()
+{
+    this->release();
+}
+void ChunkTexture::release()
+{
+    if ( this->texture != NULL ) {
+        SDL_DestroyTexture( this->texture );
+        this->texture = NULL;
+    }
+    this->valid = false;
+}
+void ChunkTexture::invalidate()
+{
+    // target textures lose their content on a device reset, see SDL_RENDER_TARGETS_RESET
+    this->valid = false;
+}
+void ChunkTexture::invalidateTile( Chunk& chunk, int row, int col )
+{
+    // an invalid texture is redrawn whole anyway
+    if ( this->valid ) {
+        this->dirty.set( chunk.length(), row, col );
+    }
+}
+void ChunkTexture::redraw( SDL_Renderer* renderer, Chunk& chunk )
+{
+    // draw the invalid part of the chunk into the texture at scale 1, then put
+    // back the render target, scale and viewport of the pass that is in
+    // progress. Changing the target resets the viewport
+    float scaleX, scaleY;
+    SDL_Rect viewport;
+    SDL_Texture* previousTarget = SDL_GetRenderTarget( renderer );
+    SDL_RenderGetScale( renderer, &scaleX, &scaleY );
+    SDL_RenderGetViewport( renderer, &viewport );
+    SDL_SetRenderTarget( renderer, this->texture );
+    SDL_RenderSetScale( renderer, 1.0, 1.0 );
+    SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+
+    // scattered edits redraw just their tiles, two draw calls each. Once that
+    // is more than redrawing every tile of their bounding rect, do the rect
+    int col0 = 0, col1 = chunk.length(), row0 = 0, row1 = chunk.length();
+    if ( this->valid ) {
+        col0 = this->dirty.col0();
+        col1 = this->dirty.col1();
+        row0 = this->dirty.row0();
+        row1 = this->dirty.row1();
+    }
+    if ( this->valid && 2 * this->dirty.count() < ( col1 - col0 ) * ( row1 - row0 ) ) {
+        std::vector<SDL_Rect> rects;
+        rects.reserve( this->dirty.count() );
+        this->dirty.forEach( [&]( int row, int col ) {
+            rects.push_back( { col * TILE_W, row * TILE_H, TILE_W, TILE_H } );
+        } );
+        SDL_RenderFillRects( renderer, rects.data(), rects.size() );
+        for ( size_t i=0; i<rects.size(); i++ ) {
+            Uint8 type = chunk.getType( rects[ i ].y / TILE_H, rects[ i ].x / TILE_W );
+            SDL_RenderCopy( renderer, gTileTexture, &gTileClips[ type ], &rects[ i ] );
+        }
+    }
+    else {
+        SDL_Rect area = { col0 * TILE_W, row0 * TILE_H, ( col1 - col0 ) * TILE_W, ( row1 - row0 ) * TILE_H };
+        SDL_RenderFillRect( renderer, &area );
+        SDL_Rect dstRect = { 0, 0, TILE_W, TILE_H };
+        for ( int i=row0; i<row1; i++ ) {
+            dstRect.y = i * TILE_H;
+            for ( int j=col0; j<col1; j++ ) {
+                dstRect.x = j * TILE_W;
+                SDL_RenderCopy( renderer, gTileTexture, &gTileClips[ chunk.getType( i, j ) ], &dstRect );
+            }
+        }
+    }
+
+    SDL_SetRenderTarget( renderer, previousTarget );
+    SDL_RenderSetScale( renderer, scaleX, scaleY );
+    SDL_RenderSetViewport( renderer, &viewport );
+    this->valid = true;
+    this->dirty.clear();
+}
+bool ChunkTexture::render( SDL_Renderer* renderer, Chunk& chunk, const SDL_Rect& dst )
+{
+    // returns false if the chunk could not be baked and has to be drawn per tile
+    if ( this->texture == NULL ) {
+        this->texture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                           chunk.length() * TILE_W, chunk.length() * TILE_H );
+        if ( this->texture == NULL ) {
+            printf( "Unable to create chunk texture! SDL Error: %s\n", SDL_GetError() );
+            return false;
+        }
+        this->valid = false;
+    }
+    if ( !this->valid || !this->dirty.empty() ) {
+        this->redraw( renderer, chunk );
+    }
+    SDL_RenderCopy( renderer, this->texture, NULL, &dst );
+    gDrawCalls++;
+    return true;
+}
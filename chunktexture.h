@@ -0,0 +1,31 @@
+#ifndef FERMI_CHUNKTEXTURE_H
+#define FERMI_CHUNKTEXTURE_H
+
+#include <vector>
+
+#include "common.h"
+#include "tile.h"
+
+// A chunk drawn once at full resolution into a render target texture, so a
+// frame only copies one texture per chunk in view. Edited tiles are redrawn
+// into the texture on the next render instead of rebuilding all of it
+class ChunkTexture {
+public:
+    ChunkTexture();
+    ~ChunkTexture();
+    bool render( SDL_Renderer* renderer, Chunk& chunk, const SDL_Rect& dst );
+    void invalidate();
+    void invalidateTile( Chunk& chunk, int row, int col );
+    void release();
+
+    bool baked() { return this->texture != NULL; };
+private:
+    void redraw( SDL_Renderer* renderer, Chunk& chunk );
+
+    SDL_Texture* texture;
+    bool valid;
+    // tiles edited since the last redraw
+    TileMask dirty;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef FERMI_COMMON_H
+#define FERMI_COMMON_H
+
+#include <stdio.h>
+#include <math.h>
+#include <string>
+
+#include <SDL2/SDL.h>
+
+#include "core.h"
+
+struct vec2 {
+    double x;
+    double y;
+
+    vec2( double x=0, double y=0 ) : x(x), y(y)
+    {
+    }
+
+    vec2 operator=( const vec2& other )
+    {
+        x = other.x;
+        y = other.y;
+        return *this;
+    }
+
+    vec2 operator+( const vec2& other ) const
+    {
+        return vec2( x + other.x, y + other.y );
+    }
+
+    vec2 operator-( const vec2& other ) const
+    {
+        return vec2( x - other.x, y - other.y );
+    }
+
+    bool operator==( const vec2& other ) const
+    {
+        return ( other.x == x && other.y == y );
+    }
+
+    double norm()
+    {
+        return sqrt( x*x + y*y );
+    }
+
+    double dotProd( vec2 other )
+    {
+        return x * other.x + y * other.y;
+    }
+
+    std::string str()
+    {
+        return "(" + std::to_string(x) + "," + std::to_string(y) + ")";
+    }
+};
+
+// global variables
+const int SCREEN_WIDTH = 1280;
+const int SCREEN_HEIGHT = 720;
+
+constexpr int TILE_W = FERMI_TILE_WIDTH;
+constexpr int TILE_H = FERMI_TILE_HEIGHT;
+
+constexpr int TILE_GRASS = FERMI_TILE_GRASS;
+constexpr int TILE_METAL = FERMI_TILE_METAL;
+constexpr int TILE_COUNT = FERMI_TILE_COUNT;
+
+// where each tile type is in gTileTexture
+extern SDL_Rect gTileClips[ TILE_COUNT ];
+// average color of each tile type in SDL_PIXELFORMAT_RGBA8888, for LOD images
+extern Uint32 gTileColors[ TILE_COUNT ];
+
+extern SDL_Renderer* gRenderer;
+extern SDL_Texture* gTileTexture;
+
+// number of draw calls submitted to the renderer in the current frame
+extern int gDrawCalls;
+// number of tiles drawn in the current frame
+extern int gTilesDrawn;
+
+#endif
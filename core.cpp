@@ -0,0 +1,61 @@
+#include <string.h>
+
+#include "core.h"
+#include "camera.h"
+#include "tile.h"
+#include "terrain.h"
+
+struct FermiCamera {
+    Camera camera;
+    InputSnapshot input;
+
+    FermiCamera( int w, int h ) : camera( w, h )
+    {
+        this->input.held = 0;
+        this->input.mouseX = 0;
+        this->input.mouseY = 0;
+    }
+};
+
+void fermiGenerateChunk( Uint32 seed, int tileX0, int tileY0, int length, Uint8* types )
+{
+    // generators only hold the seed, so building one per call is free
+    Chunk chunk( length );
+    TerrainGenerator( seed ).generate( chunk, tileX0, tileY0 );
+    memcpy( types, chunk.data(), (size_t)length * length );
+}
+
+FermiCamera* fermiCreateCamera( int w, int h )
+{
+    return new FermiCamera( w, h );
+}
+void fermiDestroyCamera( FermiCamera* cam )
+{
+    delete cam;
+}
+void fermiCameraInput( FermiCamera* cam, int moveX, int moveY )
+{
+    Uint32 held = 0;
+    held |= moveX < 0 ? INPUT_LEFT : 0;
+    held |= moveX > 0 ? INPUT_RIGHT : 0;
+    held |= moveY < 0 ? INPUT_UP : 0;
+    held |= moveY > 0 ? INPUT_DOWN : 0;
+    cam->input.held = held;
+    cam->camera.applyInput( cam->input );
+}
+void fermiCameraZoomBy( FermiCamera* cam, int steps )
+{
+    cam->camera.zoomBy( steps );
+}
+void fermiCameraMove( FermiCamera* cam )
+{
+    cam->camera.move();
+}
+SDL_Rect fermiCameraRect( FermiCamera* cam )
+{
+    return cam->camera.rect();
+}
+double fermiCameraZoom( FermiCamera* cam )
+{
+    return cam->camera.getZoom();
+}
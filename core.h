@@ -0,0 +1,88 @@
+#ifndef FERMI_CORE_H
+#define FERMI_CORE_H
+
+// The part of the engine both front-ends share. This header compiles as C99 and
+// as C++11: main.c uses it through the functions below, which core.cpp
+// implements on top of the C++ engine, and common.h builds on it
+
+#include <SDL2/SDL.h>
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// tile size in world pixels and the tile types. Enumerators are constant
+// expressions in C as well, so loops over tiles are compiled against them
+enum {
+    FERMI_TILE_WIDTH = 32,
+    FERMI_TILE_HEIGHT = 32
+};
+enum {
+    FERMI_TILE_GRASS = 0,
+    FERMI_TILE_METAL = 1,
+    FERMI_TILE_COUNT = 2
+};
+// chunk side length in tiles used when none is given on the command line
+enum {
+    FERMI_CHUNK_LENGTH = 64
+};
+
+static inline bool checkCollision( SDL_Rect A, SDL_Rect B )
+{
+    // if A is outside of B
+    if ( A.x >= B.x+B.w || A.x+A.w <= B.x || A.y >= B.y+B.h || A.y+A.h <= B.y ) {
+        return false;
+    }
+    return true;
+}
+
+static inline int floorDiv( int a, int b )
+{
+    // integer division rounding towards negative infinity
+    int q = a / b;
+    if ( ( a % b != 0 ) && ( ( a < 0 ) != ( b < 0 ) ) ) {
+        q--;
+    }
+    return q;
+}
+
+static inline bool visibleTileRange( SDL_Rect view, int originX, int originY, int length,
+                                     int* row0, int* row1, int* col0, int* col1 )
+{
+    // tiles of a chunk lie on a regular grid starting at its origin, so the rows
+    // and columns overlapping the view follow directly from its edges. The range
+    // is half open: [row0, row1)
+    *col0 = floorDiv( view.x - originX, FERMI_TILE_WIDTH );
+    *col1 = floorDiv( view.x + view.w - originX - 1, FERMI_TILE_WIDTH ) + 1;
+    *row0 = floorDiv( view.y - originY, FERMI_TILE_HEIGHT );
+    *row1 = floorDiv( view.y + view.h - originY - 1, FERMI_TILE_HEIGHT ) + 1;
+    if ( *col0 < 0 ) { *col0 = 0; }
+    if ( *row0 < 0 ) { *row0 = 0; }
+    if ( *col1 > length ) { *col1 = length; }
+    if ( *row1 > length ) { *row1 = length; }
+    return *col0 < *col1 && *row0 < *row1;
+}
+
+// fill types with the length x length tiles of the seeded terrain whose top
+// left tile is ( tileX0, tileY0 ), one byte per tile in row major order
+void fermiGenerateChunk( Uint32 seed, int tileX0, int tileY0, int length, Uint8* types );
+
+// the engine camera behind an opaque handle. Needs gRenderer to be created
+typedef struct FermiCamera FermiCamera;
+FermiCamera* fermiCreateCamera( int w, int h );
+void fermiDestroyCamera( FermiCamera* cam );
+// pan direction for the next moves, each -1, 0 or 1
+void fermiCameraInput( FermiCamera* cam, int moveX, int moveY );
+void fermiCameraZoomBy( FermiCamera* cam, int steps );
+void fermiCameraMove( FermiCamera* cam );
+SDL_Rect fermiCameraRect( FermiCamera* cam );
+double fermiCameraZoom( FermiCamera* cam );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
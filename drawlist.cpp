@@ -0,0 +1,48 @@
+#include "drawlist.h"
+
+DrawList::DrawList()
+{
+    this->scale = 1.0;
+    this->tileCount = 0;
+    this->worldPending = false;
+    this->inputTime = 0;
+}
+void DrawList::clear()
+{
+    // keeps the capacity, so steady frames do not allocate
+    this->commands.clear();
+    this->scale = 1.0;
+    this->tileCount = 0;
+    this->worldPending = false;
+}
+void DrawList::add( SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst )
+{
+    this->commands.push_back( { texture, src, dst } );
+}
+void DrawList::submit( SDL_Renderer* renderer )
+{
+    // texture sizes are queried here and not when recording, since only the
+    // render thread may call the renderer
+    const SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_RenderSetScale( renderer, this->scale, this->scale );
+    size_t run = 0;
+    while ( run < this->commands.size() ) {
+        SDL_Texture* texture = this->commands[ run ].texture;
+        int w = 1, h = 1;
+        if ( texture != NULL ) {
+            SDL_QueryTexture( texture, NULL, NULL, &w, &h );
+        }
+        this->vertices.clear();
+        this->indices.clear();
+        size_t end = run;
+        for ( ; end<this->commands.size() && this->commands[ end ].texture==texture; end++ ) {
+            appendQuad( this->vertices, this->indices, this->commands[ end ].src, this->commands[ end ].dst, w, h, white );
+        }
+        SDL_RenderGeometry( renderer, texture,
+                            this->vertices.data(), this->vertices.size(),
+                            this->indices.data(), this->indices.size() );
+        gDrawCalls++;
+        run = end;
+    }
+    SDL_RenderSetScale( renderer, 1.0, 1.0 );
+}
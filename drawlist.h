@@ -0,0 +1,76 @@
+#ifndef FERMI_DRAWLIST_H
+#define FERMI_DRAWLIST_H
+
+#include <vector>
+
+#include "common.h"
+
+// Appends one textured quad as two triangles: src in pixels of a texW x texH
+// texture, dst in target pixels. Shared by everything that builds geometry
+// for SDL_RenderGeometry, and inline as it runs once per tile
+inline void appendQuad( std::vector<SDL_Vertex>& vertices, std::vector<int>& indices, const SDL_Rect& src,
+                        const SDL_Rect& dst, float texW, float texH, const SDL_Color& color )
+{
+    float u0 = src.x / texW;
+    float v0 = src.y / texH;
+    float u1 = ( src.x + src.w ) / texW;
+    float v1 = ( src.y + src.h ) / texH;
+    float x0 = dst.x;
+    float y0 = dst.y;
+    float x1 = dst.x + dst.w;
+    float y1 = dst.y + dst.h;
+
+    int base = vertices.size();
+    vertices.push_back( { { x0, y0 }, color, { u0, v0 } } );
+    vertices.push_back( { { x1, y0 }, color, { u1, v0 } } );
+    vertices.push_back( { { x1, y1 }, color, { u1, v1 } } );
+    vertices.push_back( { { x0, y1 }, color, { u0, v1 } } );
+    const int quad[ 6 ] = { 0, 1, 2, 2, 3, 0 };
+    for ( int i=0; i<6; i++ ) {
+        indices.push_back( base + quad[ i ] );
+    }
+}
+
+struct DrawCommand {
+    SDL_Texture* texture;
+    SDL_Rect src;
+    SDL_Rect dst;
+};
+
+// The draw commands of one frame, recorded without calling the renderer so a
+// list can be filled on any thread and drawn later on the render thread.
+// submit() turns each run of commands with the same texture into one
+// SDL_RenderGeometry call
+class DrawList {
+public:
+    DrawList();
+    void clear();
+    void add( SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst );
+    void submit( SDL_Renderer* renderer );
+
+    int size() { return this->commands.size(); };
+    // the renderer scale the destination rects are drawn at, the camera zoom
+    float getScale() { return this->scale; };
+    void setScale( float scale ) { this->scale = scale; };
+    // tiles culled into the list, counted like gTilesDrawn
+    int tiles() { return this->tileCount; };
+    void addTiles( int count ) { this->tileCount += count; };
+    // part of the world could not be recorded and has to be drawn under the
+    // list on the render thread, see ChunkManager::render
+    bool needsWorld() { return this->worldPending; };
+    void setNeedsWorld( bool needed ) { this->worldPending = needed; };
+    // when the input the list was built from was read, for latency
+    Uint64 getInputTime() { return this->inputTime; };
+    void setInputTime( Uint64 time ) { this->inputTime = time; };
+private:
+    std::vector<DrawCommand> commands;
+    float scale;
+    int tileCount;
+    bool worldPending;
+    Uint64 inputTime;
+    // geometry of one run of commands, reused between submits
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+#endif
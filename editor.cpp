@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <algorithm>
+
+#include "editor.h"
+
+TileEditor::TileEditor()
+{
+    this->radius = 0;
+    this->stroking = false;
+    this->lastTileX = 0;
+    this->lastTileY = 0;
+}
+void TileEditor::update( const InputSnapshot& input, Camera& cam, ChunkManager& world )
+{
+    // runs once per simulation tick, with the camera where the tick left it
+    if ( ( input.held & ( INPUT_PAINT | INPUT_ERASE ) ) == 0 ) {
+        if ( this->stroking ) {
+            this->endStroke();
+        }
+        return;
+    }
+    Uint8 type = ( input.held & INPUT_PAINT ) ? TILE_METAL : TILE_GRASS;
+    int tileX, tileY;
+    cam.screenToTile( input.mouseX, input.mouseY, tileX, tileY );
+    bool first = !this->stroking;
+    if ( first ) {
+        // a new stroke drops everything that was undone
+        this->undone.clear();
+        this->done.strokes.push_back( 0 );
+        this->stroking = true;
+        this->lastTileX = tileX;
+        this->lastTileY = tileY;
+    }
+    // stamp the brush along the line from the last tile, so fast mouse moves
+    // leave no gaps. Tiles the previous stamp covered are skipped, so a
+    // large brush only touches its leading edge
+    int dx = tileX - this->lastTileX;
+    int dy = tileY - this->lastTileY;
+    int steps = std::max( abs( dx ), abs( dy ) );
+    int prevX = this->lastTileX, prevY = this->lastTileY;
+    for ( int s=first ? 0 : 1; s<=steps; s++ ) {
+        int x = this->lastTileX + ( steps > 0 ? (int)lround( (double)dx * s / steps ) : 0 );
+        int y = this->lastTileY + ( steps > 0 ? (int)lround( (double)dy * s / steps ) : 0 );
+        for ( int ty=y-this->radius; ty<=y+this->radius; ty++ ) {
+            for ( int tx=x-this->radius; tx<=x+this->radius; tx++ ) {
+                if ( s > 0 && abs( tx - prevX ) <= this->radius && abs( ty - prevY ) <= this->radius ) {
+                    continue;
+                }
+                this->paint( world, tx, ty, type );
+            }
+        }
+        prevX = x;
+        prevY = y;
+    }
+    this->lastTileX = tileX;
+    this->lastTileY = tileY;
+}
+void TileEditor::paint( ChunkManager& world, int tileX, int tileY, Uint8 type )
+{
+    Uint8 before;
+    if ( world.setTile( tileX, tileY, type, &before ) ) {
+        this->done.deltas.push_back( { tileX, tileY, before, type } );
+        this->done.strokes.back()++;
+    }
+}
+void TileEditor::endStroke()
+{
+    this->stroking = false;
+    if ( this->done.strokes.back() == 0 ) {
+        this->done.strokes.pop_back();
+    }
+    // forget the oldest strokes once the history is over its cap, but always
+    // keep the last one
+    while ( this->done.deltas.size() > editor_constants::maxHistoryDeltas && this->done.strokes.size() > 1 ) {
+        this->done.deltas.erase( this->done.deltas.begin(), this->done.deltas.begin() + this->done.strokes.front() );
+        this->done.strokes.pop_front();
+    }
+}
+bool TileEditor::undo( ChunkManager& world )
+{
+    // put back the old types newest first. The undone deltas end up in reverse
+    // order, so redo pops them in the order they were painted
+    if ( this->stroking ) {
+        this->endStroke();
+    }
+    if ( this->done.strokes.empty() ) {
+        return false;
+    }
+    size_t count = this->done.strokes.back();
+    this->done.strokes.pop_back();
+    this->undone.strokes.push_back( count );
+    for ( size_t i=0; i<count; i++ ) {
+        TileDelta delta = this->done.deltas.back();
+        this->done.deltas.pop_back();
+        world.setTile( delta.tileX, delta.tileY, delta.before );
+        this->undone.deltas.push_back( delta );
+    }
+    return true;
+}
+bool TileEditor::redo( ChunkManager& world )
+{
+    if ( this->stroking || this->undone.strokes.empty() ) {
+        return false;
+    }
+    size_t count = this->undone.strokes.back();
+    this->undone.strokes.pop_back();
+    this->done.strokes.push_back( count );
+    for ( size_t i=0; i<count; i++ ) {
+        TileDelta delta = this->undone.deltas.back();
+        this->undone.deltas.pop_back();
+        world.setTile( delta.tileX, delta.tileY, delta.after );
+        this->done.deltas.push_back( delta );
+    }
+    return true;
+}
+void TileEditor::brushBy( int steps )
+{
+    this->radius = std::max( 0, std::min( editor_constants::maxBrushRadius, this->radius + steps ) );
+}
@@ -0,0 +1,58 @@
+#ifndef FERMI_EDITOR_H
+#define FERMI_EDITOR_H
+
+#include <deque>
+
+#include "common.h"
+#include "camera.h"
+#include "input.h"
+#include "world.h"
+
+namespace editor_constants {
+    // the brush is a square of 2 * radius + 1 tiles
+    const int maxBrushRadius = 32;
+    // undo history is capped at this many changed tiles, oldest strokes first
+    const size_t maxHistoryDeltas = 1 << 20;
+};
+
+// one changed tile of a stroke
+struct TileDelta {
+    Sint32 tileX, tileY;
+    Uint8 before, after;
+};
+
+// Strokes as lists of tile deltas, newest last
+struct EditHistory {
+    std::deque<TileDelta> deltas;
+    // number of deltas in each stroke
+    std::deque<size_t> strokes;
+
+    void clear() { this->deltas.clear(); this->strokes.clear(); };
+};
+
+// Paints tiles under the mouse: PAINT held lays metal, ERASE lays grass. One
+// press to release is a stroke, which is undone and redone as a whole. Only
+// the tiles a stroke changed are remembered, with their old and new types
+class TileEditor {
+public:
+    TileEditor();
+    void update( const InputSnapshot& input, Camera& cam, ChunkManager& world );
+    bool undo( ChunkManager& world );
+    bool redo( ChunkManager& world );
+    void brushBy( int steps );
+
+    int brushRadius() { return this->radius; };
+    size_t historyBytes() { return ( this->done.deltas.size() + this->undone.deltas.size() ) * sizeof( TileDelta ); };
+private:
+    void paint( ChunkManager& world, int tileX, int tileY, Uint8 type );
+    void endStroke();
+
+    int radius;
+    bool stroking;
+    // tile under the mouse at the last tick of the stroke
+    int lastTileX, lastTileY;
+    EditHistory done;
+    EditHistory undone;
+};
+
+#endif
@@ -0,0 +1,263 @@
+#include <random>
+#include <algorithm>
+
+#include "entities.h"
+
+SpatialHash::SpatialHash()
+{
+    this->colShift = 0;
+    this->colMask = 0;
+    this->rowMask = 0;
+    this->starts.assign( 2, 0 );
+}
+int SpatialHash::bucket( int cellX, int cellY ) const
+{
+    return ( (Uint32)cellX & this->colMask ) | ( ( (Uint32)cellY & this->rowMask ) << this->colShift );
+}
+void SpatialHash::build( const int* x, const int* y, const int* w, const int* h, int count )
+{
+    // about one bucket per rect keeps buckets short without clearing a big
+    // table every tick. The table is as square as a power of two allows
+    int shift = 0;
+    while ( ( 1 << shift ) < count ) {
+        shift++;
+    }
+    this->colShift = ( shift + 1 ) / 2;
+    this->colMask = ( 1u << this->colShift ) - 1;
+    this->rowMask = ( 1u << ( shift - this->colShift ) ) - 1;
+    int buckets = 1 << shift;
+    this->starts.assign( buckets + 1, 0 );
+    this->items.resize( count );
+    this->itemX.resize( count );
+    this->itemY.resize( count );
+    this->itemW.resize( count );
+    this->itemH.resize( count );
+    this->itemBuckets.resize( count );
+    for ( int i=0; i<count; i++ ) {
+        int b = this->bucket( floorDiv( x[ i ], entity_constants::cellSize ), floorDiv( y[ i ], entity_constants::cellSize ) );
+        this->itemBuckets[ i ] = b;
+        this->starts[ b + 1 ]++;
+    }
+    for ( int b=0; b<buckets; b++ ) {
+        this->starts[ b + 1 ] += this->starts[ b ];
+    }
+    // scatter, after which starts[ b ] has moved on to the start of bucket b + 1
+    for ( int i=0; i<count; i++ ) {
+        int slot = this->starts[ this->itemBuckets[ i ] ]++;
+        this->items[ slot ] = i;
+        this->itemX[ slot ] = x[ i ];
+        this->itemY[ slot ] = y[ i ];
+        this->itemW[ slot ] = w[ i ];
+        this->itemH[ slot ] = h[ i ];
+    }
+    for ( int b=buckets; b>0; b-- ) {
+        this->starts[ b ] = this->starts[ b - 1 ];
+    }
+    this->starts[ 0 ] = 0;
+}
+
+EntityWorld::EntityWorld()
+{
+    this->gridDirty = false;
+    this->bounds = { 0, 0, 0, 0 };
+    this->bounded = false;
+}
+int EntityWorld::add( float x, float y, float velX, float velY, int w, int h )
+{
+    this->posX.push_back( x );
+    this->posY.push_back( y );
+    this->velX.push_back( velX );
+    this->velY.push_back( velY );
+    this->boxX.push_back( floor( x ) );
+    this->boxY.push_back( floor( y ) );
+    this->boxW.push_back( std::min( w, entity_constants::maxEntitySize ) );
+    this->boxH.push_back( std::min( h, entity_constants::maxEntitySize ) );
+    this->gridDirty = true;
+    return this->posX.size() - 1;
+}
+void EntityWorld::remove( int i )
+{
+    // the last entity takes the index of the removed one
+    int last = this->posX.size() - 1;
+    this->posX[ i ] = this->posX[ last ];
+    this->posY[ i ] = this->posY[ last ];
+    this->velX[ i ] = this->velX[ last ];
+    this->velY[ i ] = this->velY[ last ];
+    this->boxX[ i ] = this->boxX[ last ];
+    this->boxY[ i ] = this->boxY[ last ];
+    this->boxW[ i ] = this->boxW[ last ];
+    this->boxH[ i ] = this->boxH[ last ];
+    this->posX.pop_back();
+    this->posY.pop_back();
+    this->velX.pop_back();
+    this->velY.pop_back();
+    this->boxX.pop_back();
+    this->boxY.pop_back();
+    this->boxW.pop_back();
+    this->boxH.pop_back();
+    this->gridDirty = true;
+}
+void EntityWorld::setBounds( const SDL_Rect& bounds )
+{
+    this->bounds = bounds;
+    this->bounded = true;
+}
+void EntityWorld::spawn( int count, Uint32 seed )
+{
+    // count entities scattered over a square centred on the origin that grows
+    // with the count, so the density stays about the same: one entity per
+    // 64x64 pixels, 8 to 40 pixels wide, moving up to 2 pixels a tick per axis
+    std::minstd_rand rng( seed );
+    int side = sqrt( (double)count ) * 64;
+    SDL_Rect area = { -side / 2, -side / 2, side, side };
+    this->setBounds( area );
+    for ( int i=0; i<count; i++ ) {
+        this->add( area.x + (int)( rng() % side ), area.y + (int)( rng() % side ),
+                   (int)( rng() % 9 ) / 2.0f - 2.0f, (int)( rng() % 9 ) / 2.0f - 2.0f,
+                   8 + rng() % 33, 8 + rng() % 33 );
+    }
+}
+void EntityWorld::tick( JobSystem* jobs )
+{
+    // entities move independently of each other, so ranges of them can move
+    // on the workers. The grid is rebuilt on this thread
+    if ( jobs != NULL ) {
+        jobs->parallelFor( this->size(), [this]( int begin, int end ) { this->move( begin, end ); } );
+    }
+    else {
+        this->move( 0, this->size() );
+    }
+    this->gridDirty = true;
+    this->updateGrid();
+}
+void EntityWorld::move( int begin, int end )
+{
+    // move entities [ begin, end ) by their velocity, reflecting them off the
+    // bounds
+    for ( int i=begin; i<end; i++ ) {
+        this->posX[ i ] += this->velX[ i ];
+        this->posY[ i ] += this->velY[ i ];
+    }
+    if ( this->bounded ) {
+        float x0 = this->bounds.x, y0 = this->bounds.y;
+        for ( int i=begin; i<end; i++ ) {
+            float x1 = x0 + this->bounds.w - this->boxW[ i ];
+            float y1 = y0 + this->bounds.h - this->boxH[ i ];
+            if ( this->posX[ i ] < x0 || this->posX[ i ] > x1 ) {
+                this->velX[ i ] = -this->velX[ i ];
+                this->posX[ i ] = std::max( x0, std::min( x1, this->posX[ i ] ) );
+            }
+            if ( this->posY[ i ] < y0 || this->posY[ i ] > y1 ) {
+                this->velY[ i ] = -this->velY[ i ];
+                this->posY[ i ] = std::max( y0, std::min( y1, this->posY[ i ] ) );
+            }
+        }
+    }
+    for ( int i=begin; i<end; i++ ) {
+        this->boxX[ i ] = floor( this->posX[ i ] );
+        this->boxY[ i ] = floor( this->posY[ i ] );
+    }
+}
+void EntityWorld::updateGrid()
+{
+    if ( this->gridDirty ) {
+        this->grid.build( this->boxX.data(), this->boxY.data(), this->boxW.data(), this->boxH.data(), this->size() );
+        this->gridDirty = false;
+    }
+}
+void EntityWorld::query( const SDL_Rect& rect, std::vector<int>& found )
+{
+    // entities overlapping rect. An entity overlapping it has its top left
+    // corner less than an entity size above and left of rect, which bounds
+    // the cells to visit. The cells of one row are consecutive buckets, so
+    // each row is one span of the grid's rects, two where it wraps around the
+    // table, tested in a single batch. When the cells cover the table some
+    // buckets would be visited twice, and every entity is tested instead
+    using namespace entity_constants;
+    found.clear();
+    this->updateGrid();
+    int cx0 = floorDiv( rect.x - maxEntitySize + 1, cellSize );
+    int cx1 = floorDiv( rect.x + rect.w - 1, cellSize );
+    int cy0 = floorDiv( rect.y - maxEntitySize + 1, cellSize );
+    int cy1 = floorDiv( rect.y + rect.h - 1, cellSize );
+    const SpatialHash& g = this->grid;
+    if ( cx1 - cx0 + 1 >= g.cols() || cy1 - cy0 + 1 >= g.rows() ) {
+        RectArrays all = { this->boxX.data(), this->boxY.data(), this->boxW.data(), this->boxH.data() };
+        found.resize( this->size() );
+        found.resize( overlapIndices( all, this->size(), rect, found.data() ) );
+        return;
+    }
+    for ( int cy=cy0; cy<=cy1; cy++ ) {
+        int b0 = g.bucket( cx0, cy );
+        int b1 = g.bucket( cx1, cy );
+        if ( b0 <= b1 ) {
+            this->querySpan( g.begin( b0 ), g.end( b1 ), rect, found );
+        }
+        else {
+            int rowStart = b1 & ~( g.cols() - 1 );
+            this->querySpan( g.begin( b0 ), g.end( rowStart + g.cols() - 1 ), rect, found );
+            this->querySpan( g.begin( rowStart ), g.end( b1 ), rect, found );
+        }
+    }
+}
+void EntityWorld::querySpan( int first, int last, const SDL_Rect& rect, std::vector<int>& found )
+{
+    // the grid's rects [ first, last ) overlapping rect, as entity indices.
+    // Rects of other cells sharing the buckets only pass if they overlap too
+    const SpatialHash& g = this->grid;
+    RectArrays span = { g.x() + first, g.y() + first, g.w() + first, g.h() + first };
+    this->spanHits.resize( last - first );
+    int hits = overlapIndices( span, last - first, rect, this->spanHits.data() );
+    for ( int k=0; k<hits; k++ ) {
+        found.push_back( g.index()[ first + this->spanHits[ k ] ] );
+    }
+}
+void EntityWorld::findPairs( std::vector<EntityPair>& pairs )
+{
+    // broad phase: every overlapping pair once, lower index first. Only the
+    // 3x3 cells around an entity can hold entities overlapping it. Walking the
+    // entities in bucket order keeps the neighbouring buckets in cache
+    using namespace entity_constants;
+    pairs.clear();
+    this->updateGrid();
+    const SpatialHash& g = this->grid;
+    for ( int k=0; k<this->size(); k++ ) {
+        int i = g.index()[ k ];
+        SDL_Rect a = { g.x()[ k ], g.y()[ k ], g.w()[ k ], g.h()[ k ] };
+        int cx = floorDiv( a.x, cellSize );
+        int cy = floorDiv( a.y, cellSize );
+        for ( int ny=cy-1; ny<=cy+1; ny++ ) {
+            for ( int nx=cx-1; nx<=cx+1; nx++ ) {
+                int b = g.bucket( nx, ny );
+                for ( int m=g.begin( b ); m<g.end( b ); m++ ) {
+                    SDL_Rect r = { g.x()[ m ], g.y()[ m ], g.w()[ m ], g.h()[ m ] };
+                    int j = g.index()[ m ];
+                    if ( j > i && floorDiv( r.x, cellSize ) == nx && floorDiv( r.y, cellSize ) == ny && checkCollision( a, r ) ) {
+                        pairs.push_back( { std::min( i, j ), std::max( i, j ) } );
+                    }
+                }
+            }
+        }
+    }
+}
+void EntityWorld::render( Camera& cam, TileBatch& batch, const SDL_Rect& clip )
+{
+    // one quad per visible entity, relative to the camera like tiles
+    this->query( cam.rect(), this->visible );
+    for ( size_t v=0; v<this->visible.size(); v++ ) {
+        SDL_Rect dst = this->rect( this->visible[ v ] );
+        dst.x -= cam.rect().x;
+        dst.y -= cam.rect().y;
+        batch.add( clip, dst );
+    }
+}
+void EntityWorld::render( Camera& cam, DrawList& list, SDL_Texture* texture, const SDL_Rect& clip )
+{
+    this->query( cam.rect(), this->visible );
+    for ( size_t v=0; v<this->visible.size(); v++ ) {
+        SDL_Rect dst = this->rect( this->visible[ v ] );
+        dst.x -= cam.rect().x;
+        dst.y -= cam.rect().y;
+        list.add( texture, clip, dst );
+    }
+}
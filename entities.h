@@ -0,0 +1,106 @@
+#ifndef FERMI_ENTITIES_H
+#define FERMI_ENTITIES_H
+
+#include <vector>
+
+#include "common.h"
+#include "camera.h"
+#include "tile.h"
+#include "aabb.h"
+#include "jobs.h"
+
+namespace entity_constants {
+    // side of a spatial hash cell in world pixels. Entities are hashed by their
+    // top left corner and may not be larger than a cell, so two overlapping
+    // entities are always in the same or neighbouring cells
+    const int cellSize = 64;
+    const int maxEntitySize = cellSize;
+};
+
+struct EntityPair {
+    int a;
+    int b;
+};
+
+// Uniform grid over the unbounded world, wrapped onto a table of buckets the
+// way a torus is: cell ( x, y ) goes to bucket ( x mod cols, y mod rows ).
+// Neighbouring cells are neighbouring buckets, and an area smaller than the
+// table has no two cells in one bucket. Distinct cells can still share a
+// bucket, so callers filter by cell. build() sorts the rects into their
+// buckets with a counting sort and keeps a copy of each in that order, so
+// scanning a bucket reads contiguous memory
+class SpatialHash {
+public:
+    SpatialHash();
+    void build( const int* x, const int* y, const int* w, const int* h, int count );
+    int bucket( int cellX, int cellY ) const;
+
+    int buckets() const { return this->starts.size() - 1; };
+    // the table is cols() x rows() buckets, a row of cells maps to a row of
+    // buckets
+    int cols() const { return this->colMask + 1; };
+    int rows() const { return this->rowMask + 1; };
+    // the rects of bucket b are [ begin( b ), end( b ) ) in the arrays below
+    int begin( int b ) const { return this->starts[ b ]; };
+    int end( int b ) const { return this->starts[ b + 1 ]; };
+    // index of the rect in the arrays given to build()
+    const int* index() const { return this->items.data(); };
+    const int* x() const { return this->itemX.data(); };
+    const int* y() const { return this->itemY.data(); };
+    const int* w() const { return this->itemW.data(); };
+    const int* h() const { return this->itemH.data(); };
+private:
+    int colShift;
+    Uint32 colMask, rowMask;
+    // first rect of each bucket, plus one past the last rect
+    std::vector<int> starts;
+    std::vector<int> items;
+    std::vector<int> itemX, itemY, itemW, itemH;
+    // bucket of each rect, kept between the two passes of build()
+    std::vector<int> itemBuckets;
+};
+
+// Moving entities stored as one array per field, so a tick streams through
+// contiguous memory. An entity is an index into the arrays; removing one moves
+// the last entity into its place. Queries go through a spatial hash rebuilt
+// at the end of every tick
+class EntityWorld {
+public:
+    EntityWorld();
+    int add( float x, float y, float velX, float velY, int w, int h );
+    void remove( int i );
+    void setBounds( const SDL_Rect& bounds );
+    void spawn( int count, Uint32 seed );
+    void tick( JobSystem* jobs = NULL );
+    void query( const SDL_Rect& rect, std::vector<int>& found );
+    void findPairs( std::vector<EntityPair>& pairs );
+    void render( Camera& cam, TileBatch& batch, const SDL_Rect& clip );
+    void render( Camera& cam, DrawList& list, SDL_Texture* texture, const SDL_Rect& clip );
+
+    int size() { return this->posX.size(); };
+    SDL_Rect rect( int i ) { SDL_Rect r = { this->boxX[ i ], this->boxY[ i ], this->boxW[ i ], this->boxH[ i ] }; return r; };
+    // bounding boxes as separate arrays of x, y, width and height
+    const int* rectX() { return this->boxX.data(); };
+    const int* rectY() { return this->boxY.data(); };
+    const int* rectW() { return this->boxW.data(); };
+    const int* rectH() { return this->boxH.data(); };
+private:
+    void move( int begin, int end );
+    void updateGrid();
+    void querySpan( int first, int last, const SDL_Rect& rect, std::vector<int>& found );
+
+    // world pixels and world pixels per tick
+    std::vector<float> posX, posY, velX, velY;
+    // integer bounding box of each entity, the position rounded down
+    std::vector<int> boxX, boxY, boxW, boxH;
+    SpatialHash grid;
+    // the grid no longer matches the entities
+    bool gridDirty;
+    // entities bounce off the edges of bounds, if set
+    SDL_Rect bounds;
+    bool bounded;
+    std::vector<int> visible;
+    std::vector<int> spanHits;
+};
+
+#endif
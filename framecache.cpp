@@ -0,0 +1,184 @@
+#include <math.h>
+#include <algorithm>
+
+#include "framecache.h"
+#include "profiler.h"
+
+namespace {
+    int alignment( double zoom )
+    {
+        // smallest step in world pixels that is a whole number of screen
+        // pixels at this zoom, 0 if there is none. Partial redraws start on
+        // such a step so tiles land on exactly the pixels a full redraw uses
+        for ( int g=1; g<=framecache_constants::maxAlignment; g++ ) {
+            if ( fabs( g * zoom - round( g * zoom ) ) < 1e-6 ) {
+                return g;
+            }
+        }
+        return 0;
+    }
+
+    bool wholePixels( double v )
+    {
+        return fabs( v - round( v ) ) < 1e-6;
+    }
+};
+
+FrameCache::FrameCache( int w, int h )
+{
+    this->w = w;
+    this->h = h;
+    this->front = NULL;
+    this->back = NULL;
+    this->valid = false;
+    this->lastX = this->lastY = 0;
+    this->lastZoom = 0.0;
+    this->lastRedrawn = 0;
+}
+FrameCache::~FrameCache()
+{
+    this->release();
+}
+void FrameCache::release()
+{
+    if ( this->front != NULL ) {
+        SDL_DestroyTexture( this->front );
+        this->front = NULL;
+    }
+    if ( this->back != NULL ) {
+        SDL_DestroyTexture( this->back );
+        this->back = NULL;
+    }
+    this->valid = false;
+}
+void FrameCache::invalidate()
+{
+    // redraw everything next frame: the renderer changed, or target textures
+    // lost their content, see SDL_RENDER_TARGETS_RESET
+    this->valid = false;
+}
+void FrameCache::invalidateWorld( const SDL_Rect& rect )
+{
+    this->dirtyWorld.push_back( rect );
+}
+void FrameCache::addRegion( const SDL_Rect& region )
+{
+    SDL_Rect screen = { 0, 0, this->w, this->h };
+    SDL_Rect clipped;
+    if ( !SDL_IntersectRect( &region, &screen, &clipped ) ) {
+        return;
+    }
+    if ( (int)this->regions.size() < framecache_constants::maxRegions ) {
+        this->regions.push_back( clipped );
+        return;
+    }
+    SDL_Rect merged = this->regions.back();
+    SDL_UnionRect( &merged, &clipped, &this->regions.back() );
+}
+bool FrameCache::redrawRegion( SDL_Renderer* renderer, Camera& camera, const SDL_Rect& region, int alignment,
+                               const std::function<void( Camera& )>& draw )
+{
+    // draw the world into one screen rect of the front texture. The viewport
+    // clips the drawing to the rect, and the camera box is narrowed to the
+    // same area so only tiles inside it are submitted. The box origin is
+    // moved back to an aligned world position, whose screen position is a
+    // whole pixel
+    double zoom = camera.getZoom();
+    SDL_Rect view = camera.rect();
+    int stepX = (int)floor( region.x / ( zoom * alignment ) ) * alignment;
+    int stepY = (int)floor( region.y / ( zoom * alignment ) ) * alignment;
+    int vx = (int)round( stepX * zoom );
+    int vy = (int)round( stepY * zoom );
+    SDL_Rect viewport = { vx, vy, region.x + region.w - vx, region.y + region.h - vy };
+
+    SDL_RenderSetViewport( renderer, &viewport );
+    SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+    SDL_RenderFillRect( renderer, NULL );
+    camera.rect() = { view.x + stepX, view.y + stepY,
+                      (int)ceil( viewport.w / zoom ) + 1, (int)ceil( viewport.h / zoom ) + 1 };
+    draw( camera );
+    camera.rect() = view;
+    SDL_RenderSetViewport( renderer, NULL );
+    this->lastRedrawn += (long)region.w * region.h;
+    return true;
+}
+bool FrameCache::render( SDL_Renderer* renderer, Camera& camera, const std::function<void( Camera& )>& draw )
+{
+    // compose this frame's tile layer and copy it to the current target.
+    // Returns false if the textures could not be created; the caller then
+    // has to draw the frame itself
+    PROFILE_ZONE( "frame cache" );
+    if ( this->front == NULL ) {
+        this->front = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, this->w, this->h );
+        this->back = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, this->w, this->h );
+        if ( this->front == NULL || this->back == NULL ) {
+            printf( "Unable to create frame cache textures! SDL Error: %s\n", SDL_GetError() );
+            this->release();
+            return false;
+        }
+        this->valid = false;
+    }
+
+    double zoom = camera.getZoom();
+    SDL_Rect& view = camera.rect();
+    int step = alignment( zoom );
+    double shiftX = ( this->lastX - view.x ) * zoom;
+    double shiftY = ( this->lastY - view.y ) * zoom;
+    // a partial redraw needs the old frame at a whole pixel offset
+    bool full = !this->valid || zoom != this->lastZoom || step == 0 ||
+                !wholePixels( shiftX ) || !wholePixels( shiftY ) ||
+                fabs( shiftX ) >= this->w || fabs( shiftY ) >= this->h;
+
+    SDL_Texture* previousTarget = SDL_GetRenderTarget( renderer );
+    SDL_RenderSetScale( renderer, 1.0, 1.0 );
+    this->regions.clear();
+    if ( full ) {
+        this->regions.push_back( { 0, 0, this->w, this->h } );
+    }
+    else {
+        int sx = (int)round( shiftX );
+        int sy = (int)round( shiftY );
+        if ( sx != 0 || sy != 0 ) {
+            // move the old frame into the other texture and redraw the strips
+            // it no longer covers
+            SDL_Rect dst = { sx, sy, this->w, this->h };
+            SDL_SetRenderTarget( renderer, this->back );
+            SDL_SetTextureBlendMode( this->front, SDL_BLENDMODE_NONE );
+            SDL_RenderCopy( renderer, this->front, NULL, &dst );
+            gDrawCalls++;
+            std::swap( this->front, this->back );
+            if ( sx != 0 ) {
+                this->addRegion( { sx > 0 ? 0 : this->w + sx, 0, abs( sx ), this->h } );
+            }
+            if ( sy != 0 ) {
+                this->addRegion( { 0, sy > 0 ? 0 : this->h + sy, this->w, abs( sy ) } );
+            }
+        }
+        for ( size_t i=0; i<this->dirtyWorld.size(); i++ ) {
+            const SDL_Rect& r = this->dirtyWorld[ i ];
+            int x0 = (int)floor( ( r.x - view.x ) * zoom );
+            int y0 = (int)floor( ( r.y - view.y ) * zoom );
+            int x1 = (int)ceil( ( r.x + r.w - view.x ) * zoom );
+            int y1 = (int)ceil( ( r.y + r.h - view.y ) * zoom );
+            this->addRegion( { x0, y0, x1 - x0, y1 - y0 } );
+        }
+    }
+    this->dirtyWorld.clear();
+
+    SDL_SetRenderTarget( renderer, this->front );
+    this->lastRedrawn = 0;
+    for ( size_t i=0; i<this->regions.size(); i++ ) {
+        this->redrawRegion( renderer, camera, this->regions[ i ], full ? 1 : step, draw );
+    }
+
+    SDL_SetRenderTarget( renderer, previousTarget );
+    SDL_RenderSetScale( renderer, 1.0, 1.0 );
+    SDL_SetTextureBlendMode( this->front, SDL_BLENDMODE_NONE );
+    SDL_RenderCopy( renderer, this->front, NULL, NULL );
+    gDrawCalls++;
+    this->valid = true;
+    this->lastX = view.x;
+    this->lastY = view.y;
+    this->lastZoom = zoom;
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef FERMI_FRAMECACHE_H
+#define FERMI_FRAMECACHE_H
+
+#include <vector>
+#include <functional>
+
+#include "common.h"
+#include "camera.h"
+
+namespace framecache_constants {
+    // dirty rects beyond this many are merged into their bounding box
+    const int maxRegions = 16;
+    // largest number of world pixels a partial redraw origin is snapped to,
+    // see alignment()
+    const int maxAlignment = 64;
+};
+
+// The tile layer of the last frame, kept in a render target texture so a frame
+// where little changed only redraws what did: the strips scrolled into view
+// after a pan, and world areas reported with invalidateWorld(). Everything
+// else is copied from the previous frame. Two textures are kept because a
+// pan copies the old frame into the other one at an offset.
+class FrameCache {
+public:
+    FrameCache( int w, int h );
+    ~FrameCache();
+    bool render( SDL_Renderer* renderer, Camera& camera, const std::function<void( Camera& )>& draw );
+    void invalidate();
+    void invalidateWorld( const SDL_Rect& rect );
+    void release();
+
+    // screen pixels redrawn by the last render()
+    long redrawnPixels() { return this->lastRedrawn; };
+private:
+    bool redrawRegion( SDL_Renderer* renderer, Camera& camera, const SDL_Rect& region, int alignment,
+                       const std::function<void( Camera& )>& draw );
+    void addRegion( const SDL_Rect& region );
+
+    int w, h;
+    SDL_Texture* front;
+    SDL_Texture* back;
+    bool valid;
+    // camera the front texture was drawn with
+    int lastX, lastY;
+    double lastZoom;
+    // world rects changed since the last frame
+    std::vector<SDL_Rect> dirtyWorld;
+    // screen rects to redraw this frame
+    std::vector<SDL_Rect> regions;
+    long lastRedrawn;
+};
+
+#endif
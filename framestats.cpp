@@ -0,0 +1,96 @@
+#include <algorithm>
+
+#include "framestats.h"
+
+FrameStats::FrameStats()
+{
+    this->ring.resize( framestats_constants::windowFrames );
+    this->next = 0;
+    this->count = 0;
+    this->frameNumber = 0;
+    this->csv = NULL;
+    this->sorted.reserve( framestats_constants::windowFrames );
+}
+FrameStats::~FrameStats()
+{
+    this->closeCsv();
+}
+void FrameStats::add( const FrameSample& sample )
+{
+    this->ring[ this->next ] = sample;
+    this->next = ( this->next + 1 ) % framestats_constants::windowFrames;
+    this->count = std::min( this->count + 1, framestats_constants::windowFrames );
+    if ( this->csv != NULL ) {
+        fprintf( this->csv, "%ld,%.3f,%d,%d,%d,%d\n", this->frameNumber, sample.ms, sample.drawCalls,
+                 sample.tilesDrawn, sample.chunksBuilt, sample.chunksPending );
+    }
+    this->frameNumber++;
+}
+void FrameStats::summarize( FrameWindow& window )
+{
+    // all zero until the first frame, never a division by zero
+    window.frames = this->count;
+    window.minMs = window.avgMs = window.p99Ms = window.maxMs = 0.0;
+    if ( this->count == 0 ) {
+        return;
+    }
+    this->sorted.clear();
+    double totalMs = 0.0;
+    for ( int i=0; i<this->count; i++ ) {
+        this->sorted.push_back( this->at( i ).ms );
+        totalMs += this->at( i ).ms;
+    }
+    size_t p99 = std::min( this->sorted.size() - 1, (size_t)( 0.99 * this->sorted.size() ) );
+    std::nth_element( this->sorted.begin(), this->sorted.begin() + p99, this->sorted.end() );
+    window.p99Ms = this->sorted[ p99 ];
+    window.minMs = *std::min_element( this->sorted.begin(), this->sorted.end() );
+    window.maxMs = *std::max_element( this->sorted.begin(), this->sorted.end() );
+    window.avgMs = totalMs / this->count;
+}
+void FrameStats::renderGraph( SDL_Renderer* renderer, int x, int y )
+{
+    // one bar per frame, newest on the right, on a dark background with a line
+    // at the frame budget. Bars of one color go out in a single call
+    using namespace framestats_constants;
+    const SDL_Color colors[ 3 ] = { { 0x40, 0xD0, 0x40, 0xFF }, { 0xE0, 0xD0, 0x30, 0xFF }, { 0xE0, 0x30, 0x30, 0xFF } };
+    for ( int c=0; c<3; c++ ) {
+        this->bars[ c ].clear();
+    }
+    int left = x + windowFrames - this->count;
+    for ( int i=0; i<this->count; i++ ) {
+        double ms = this->at( i ).ms;
+        int h = std::max( 1, std::min( graphHeight, (int)( ms / graphMs * graphHeight ) ) );
+        int c = ms > 2.0 * budgetMs ? 2 : ( ms > budgetMs ? 1 : 0 );
+        this->bars[ c ].push_back( { left + i, y + graphHeight - h, 1, h } );
+    }
+    SDL_Rect background = { x, y, windowFrames, graphHeight };
+    SDL_SetRenderDrawColor( renderer, 0x20, 0x20, 0x20, 0xFF );
+    SDL_RenderFillRect( renderer, &background );
+    for ( int c=0; c<3; c++ ) {
+        if ( !this->bars[ c ].empty() ) {
+            SDL_SetRenderDrawColor( renderer, colors[ c ].r, colors[ c ].g, colors[ c ].b, colors[ c ].a );
+            SDL_RenderFillRects( renderer, this->bars[ c ].data(), this->bars[ c ].size() );
+        }
+    }
+    int budgetY = y + graphHeight - (int)( budgetMs / graphMs * graphHeight );
+    SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+    SDL_RenderDrawLine( renderer, x, budgetY, x + windowFrames - 1, budgetY );
+}
+bool FrameStats::openCsv( const char* path )
+{
+    this->closeCsv();
+    this->csv = fopen( path, "w" );
+    if ( this->csv == NULL ) {
+        printf( "Unable to open %s for writing!\n", path );
+        return false;
+    }
+    fprintf( this->csv, "frame,ms,draw_calls,tiles_drawn,chunks_built,chunks_pending\n" );
+    return true;
+}
+void FrameStats::closeCsv()
+{
+    if ( this->csv != NULL ) {
+        fclose( this->csv );
+        this->csv = NULL;
+    }
+}
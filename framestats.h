@@ -0,0 +1,61 @@
+#ifndef FERMI_FRAMESTATS_H
+#define FERMI_FRAMESTATS_H
+
+#include <stdio.h>
+#include <vector>
+
+#include "common.h"
+
+namespace framestats_constants {
+    // frames in the rolling window, four seconds at 60 FPS
+    const int windowFrames = 240;
+    // the graph draws one bar per frame; a bar of graphMs fills its height
+    const int graphHeight = 64;
+    const double graphMs = 50.0;
+    // frames over budget are drawn yellow, over twice the budget red
+    const double budgetMs = 1000.0 / 60.0;
+};
+
+// what happened in one frame
+struct FrameSample {
+    double ms;
+    int drawCalls;
+    int tilesDrawn;
+    // chunks that finished building during the frame
+    int chunksBuilt;
+    int chunksPending;
+};
+
+struct FrameWindow {
+    int frames;
+    double minMs, avgMs, p99Ms, maxMs;
+};
+
+// Frame times of the last windowFrames frames in a ring buffer, so a hitch
+// shows up in the numbers and the graph for a few seconds and then leaves
+// again, unlike a lifetime average. Every sample can also be appended to a
+// CSV file as it is added
+class FrameStats {
+public:
+    FrameStats();
+    ~FrameStats();
+    void add( const FrameSample& sample );
+    void summarize( FrameWindow& window );
+    void renderGraph( SDL_Renderer* renderer, int x, int y );
+    bool openCsv( const char* path );
+    void closeCsv();
+private:
+    // oldest first, i is 0 for the oldest frame in the window
+    const FrameSample& at( int i ) { return this->ring[ ( this->next + framestats_constants::windowFrames - this->count + i ) % framestats_constants::windowFrames ]; };
+
+    std::vector<FrameSample> ring;
+    int next;
+    int count;
+    long frameNumber;
+    FILE* csv;
+    // scratch space reused every frame
+    std::vector<double> sorted;
+    std::vector<SDL_Rect> bars[ 3 ];
+};
+
+#endif
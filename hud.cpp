@@ -0,0 +1,157 @@
+#include <string.h>
+#include <algorithm>
+
+#include "hud.h"
+#include "drawlist.h"
+
+GlyphAtlas::GlyphAtlas()
+{
+    this->atlasTexture = NULL;
+    this->atlasW = 0;
+    this->atlasH = 0;
+    this->height = 0;
+}
+GlyphAtlas::~GlyphAtlas()
+{
+    this->release();
+}
+void GlyphAtlas::release()
+{
+    // the texture belongs to the renderer, so this has to run before SDL_Quit
+    if ( this->atlasTexture != NULL ) {
+        SDL_DestroyTexture( this->atlasTexture );
+        this->atlasTexture = NULL;
+    }
+}
+bool GlyphAtlas::build( SDL_Renderer* renderer, TTF_Font* font )
+{
+    // rasterize every glyph in white, pack them in rows and upload the result
+    // as one texture. Text color is applied later through vertex colors
+    const SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    const int count = hud_constants::lastGlyph - hud_constants::firstGlyph + 1;
+    SDL_Surface* glyphs[ count ];
+    int penX = 0, penY = 0, rowH = 0;
+    for ( int i=0; i<count; i++ ) {
+        Uint16 c = hud_constants::firstGlyph + i;
+        int minx, maxx, miny, maxy, advance;
+        glyphs[ i ] = TTF_RenderGlyph_Blended( font, c, white );
+        if ( glyphs[ i ] == NULL || TTF_GlyphMetrics( font, c, &minx, &maxx, &miny, &maxy, &advance ) != 0 ) {
+            printf( "Unable to rasterize glyph '%c'! SDL_ttf Error: %s\n", c, TTF_GetError() );
+            advance = 0;
+        }
+        int w = glyphs[ i ] != NULL ? glyphs[ i ]->w : 0;
+        int h = glyphs[ i ] != NULL ? glyphs[ i ]->h : 0;
+        if ( penX + w > hud_constants::atlasWidth ) {
+            penX = 0;
+            penY += rowH;
+            rowH = 0;
+        }
+        this->clips[ i ] = { penX, penY, w, h };
+        this->advances[ i ] = advance;
+        penX += w;
+        rowH = std::max( rowH, h );
+    }
+    this->atlasW = hud_constants::atlasWidth;
+    this->atlasH = penY + rowH;
+    this->height = TTF_FontHeight( font );
+
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat( 0, this->atlasW, this->atlasH, 32, SDL_PIXELFORMAT_RGBA32 );
+    if ( atlas == NULL ) {
+        printf( "Unable to create glyph atlas surface! SDL Error: %s\n", SDL_GetError() );
+    }
+    for ( int i=0; i<count; i++ ) {
+        if ( glyphs[ i ] == NULL ) {
+            continue;
+        }
+        if ( atlas != NULL ) {
+            // copy the glyph alpha as is instead of blending it onto the atlas
+            SDL_SetSurfaceBlendMode( glyphs[ i ], SDL_BLENDMODE_NONE );
+            SDL_BlitSurface( glyphs[ i ], NULL, atlas, &this->clips[ i ] );
+        }
+        SDL_FreeSurface( glyphs[ i ] );
+    }
+    if ( atlas == NULL ) {
+        return false;
+    }
+
+    this->atlasTexture = SDL_CreateTextureFromSurface( renderer, atlas );
+    SDL_FreeSurface( atlas );
+    if ( this->atlasTexture == NULL ) {
+        printf( "Unable to create glyph atlas texture! SDL Error: %s\n", SDL_GetError() );
+        return false;
+    }
+    SDL_SetTextureBlendMode( this->atlasTexture, SDL_BLENDMODE_BLEND );
+    return true;
+}
+bool GlyphAtlas::glyph( char c, SDL_Rect& clip, int& advance )
+{
+    if ( c < hud_constants::firstGlyph || c > hud_constants::lastGlyph ) {
+        return false;
+    }
+    clip = this->clips[ c - hud_constants::firstGlyph ];
+    advance = this->advances[ c - hud_constants::firstGlyph ];
+    return true;
+}
+
+HudText::HudText( GlyphAtlas* atlas, SDL_Color color )
+{
+    this->atlas = atlas;
+    this->color = color;
+    this->x = 0;
+    this->y = 0;
+    this->text[ 0 ] = '\0';
+    this->layoutCount = 0;
+    // enough room for the longest text, so layouts never reallocate
+    this->vertices.reserve( 4 * hud_constants::maxTextLength );
+    this->indices.reserve( 6 * hud_constants::maxTextLength );
+}
+void HudText::setText( const char* text )
+{
+    if ( strncmp( this->text, text, hud_constants::maxTextLength ) == 0 ) {
+        return;
+    }
+    strncpy( this->text, text, hud_constants::maxTextLength );
+    this->text[ hud_constants::maxTextLength ] = '\0';
+    this->layout();
+}
+void HudText::setPosition( int x, int y )
+{
+    if ( x == this->x && y == this->y ) {
+        return;
+    }
+    this->x = x;
+    this->y = y;
+    this->layout();
+}
+void HudText::layout()
+{
+    // turn the text into one quad per glyph, sampling from the atlas
+    int texW = 1, texH = 1;
+    if ( this->atlas->texture() != NULL ) {
+        SDL_QueryTexture( this->atlas->texture(), NULL, NULL, &texW, &texH );
+    }
+    this->vertices.clear();
+    this->indices.clear();
+    int penX = this->x;
+    for ( const char* c=this->text; *c != '\0'; c++ ) {
+        SDL_Rect clip;
+        int advance;
+        if ( !this->atlas->glyph( *c, clip, advance ) ) {
+            continue;
+        }
+        SDL_Rect dst = { penX, this->y, clip.w, clip.h };
+        appendQuad( this->vertices, this->indices, clip, dst, texW, texH, this->color );
+        penX += advance;
+    }
+    this->layoutCount++;
+}
+void HudText::render( SDL_Renderer* renderer )
+{
+    if ( this->indices.empty() ) {
+        return;
+    }
+    SDL_RenderGeometry( renderer, this->atlas->texture(),
+                        this->vertices.data(), this->vertices.size(),
+                        this->indices.data(), this->indices.size() );
+    gDrawCalls++;
+}
@@ -0,0 +1,61 @@
+#ifndef FERMI_HUD_H
+#define FERMI_HUD_H
+
+#include <vector>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "common.h"
+
+namespace hud_constants {
+    // printable ASCII range baked into the atlas
+    const int firstGlyph = 32;
+    const int lastGlyph = 126;
+    const int atlasWidth = 512;
+    const int maxTextLength = 127;
+};
+
+// All printable ASCII glyphs of a font rasterized once into a single texture
+class GlyphAtlas {
+public:
+    GlyphAtlas();
+    ~GlyphAtlas();
+    bool build( SDL_Renderer* renderer, TTF_Font* font );
+    void release();
+
+    SDL_Texture* texture() { return this->atlasTexture; };
+    int lineHeight() { return this->height; };
+    // returns the clip of c inside the atlas and its advance, false if c is not in the atlas
+    bool glyph( char c, SDL_Rect& clip, int& advance );
+private:
+    SDL_Texture* atlasTexture;
+    int atlasW, atlasH;
+    int height;
+    SDL_Rect clips[ hud_constants::lastGlyph - hud_constants::firstGlyph + 1 ];
+    int advances[ hud_constants::lastGlyph - hud_constants::firstGlyph + 1 ];
+};
+
+// A line of HUD text drawn from atlas quads. The quads are only rebuilt when
+// the text or position changes and are drawn with one SDL_RenderGeometry call
+class HudText {
+public:
+    HudText( GlyphAtlas* atlas, SDL_Color color );
+    void setText( const char* text );
+    void setPosition( int x, int y );
+    void render( SDL_Renderer* renderer );
+
+    int layouts() { return this->layoutCount; };
+private:
+    void layout();
+
+    GlyphAtlas* atlas;
+    SDL_Color color;
+    int x, y;
+    char text[ hud_constants::maxTextLength + 1 ];
+    int layoutCount;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "input.h"
+
+namespace {
+    Uint32 keyButton( SDL_Keycode key )
+    {
+        switch ( key ) {
+            case SDLK_UP:
+                return INPUT_UP;
+            case SDLK_DOWN:
+                return INPUT_DOWN;
+            case SDLK_LEFT:
+                return INPUT_LEFT;
+            case SDLK_RIGHT:
+                return INPUT_RIGHT;
+        }
+        return 0;
+    }
+
+    Uint32 mouseButton( Uint8 button )
+    {
+        switch ( button ) {
+            case SDL_BUTTON_LEFT:
+                return INPUT_PAINT;
+            case SDL_BUTTON_RIGHT:
+                return INPUT_ERASE;
+        }
+        return 0;
+    }
+};
+
+InputSystem::InputSystem()
+{
+    this->state.held = 0;
+    this->state.mouseX = 0;
+    this->state.mouseY = 0;
+}
+void InputSystem::setHeld( Uint32 button, bool down )
+{
+    if ( down ) {
+        this->state.held |= button;
+    }
+    else {
+        this->state.held &= ~button;
+    }
+}
+void InputSystem::push( const Command& command )
+{
+    this->commands.push_back( command );
+}
+bool InputSystem::pollCommand( Command& command )
+{
+    if ( this->commands.empty() ) {
+        return false;
+    }
+    command = this->commands.front();
+    this->commands.pop_front();
+    return true;
+}
+void InputSystem::handleEvent( const SDL_Event& e )
+{
+    // every field read below belongs to the event type checked before it
+    switch ( e.type ) {
+        case SDL_QUIT:
+            this->push( { CMD_QUIT, 0 } );
+            break;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            if ( e.key.repeat != 0 ) {
+                break;
+            }
+            if ( keyButton( e.key.keysym.sym ) != 0 ) {
+                this->setHeld( keyButton( e.key.keysym.sym ), e.type == SDL_KEYDOWN );
+            }
+            else if ( e.type == SDL_KEYDOWN ) {
+                switch ( e.key.keysym.sym ) {
+                    case SDLK_ESCAPE:
+                        this->push( { CMD_QUIT, 0 } );
+                        break;
+                    case SDLK_b:
+                        this->push( { CMD_CYCLE_RENDERER, 0 } );
+                        break;
+                    case SDLK_i:
+                        this->push( { CMD_TOGGLE_INCREMENTAL, 0 } );
+                        break;
+                    case SDLK_F3:
+                        this->push( { CMD_TOGGLE_STATS, 0 } );
+                        break;
+                    case SDLK_F5:
+                        this->push( { CMD_SAVE_WORLD, 0 } );
+                        break;
+                    case SDLK_z:
+                        if ( e.key.keysym.mod & KMOD_CTRL ) {
+                            this->push( { ( e.key.keysym.mod & KMOD_SHIFT ) ? CMD_REDO : CMD_UNDO, 0 } );
+                        }
+                        break;
+                    case SDLK_y:
+                        if ( e.key.keysym.mod & KMOD_CTRL ) {
+                            this->push( { CMD_REDO, 0 } );
+                        }
+                        break;
+                    case SDLK_LEFTBRACKET:
+                        this->push( { CMD_BRUSH, -1 } );
+                        break;
+                    case SDLK_RIGHTBRACKET:
+                        this->push( { CMD_BRUSH, 1 } );
+                        break;
+                }
+            }
+            break;
+        case SDL_MOUSEWHEEL:
+            if ( e.wheel.y != 0 ) {
+                this->push( { CMD_ZOOM, e.wheel.y } );
+            }
+            break;
+        case SDL_MOUSEMOTION:
+            this->state.mouseX = e.motion.x;
+            this->state.mouseY = e.motion.y;
+            break;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            this->state.mouseX = e.button.x;
+            this->state.mouseY = e.button.y;
+            this->setHeld( mouseButton( e.button.button ), e.type == SDL_MOUSEBUTTONDOWN );
+            break;
+        case SDL_RENDER_TARGETS_RESET:
+            this->push( { CMD_TARGETS_RESET, 0 } );
+            break;
+    }
+}
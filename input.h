@@ -0,0 +1,67 @@
+#ifndef FERMI_INPUT_H
+#define FERMI_INPUT_H
+
+#include <deque>
+
+#include "common.h"
+
+// controls that are held down, as bits of InputSnapshot::held
+enum InputButton {
+    INPUT_UP = 1 << 0,
+    INPUT_DOWN = 1 << 1,
+    INPUT_LEFT = 1 << 2,
+    INPUT_RIGHT = 1 << 3,
+    INPUT_PAINT = 1 << 4,   // left mouse button
+    INPUT_ERASE = 1 << 5    // right mouse button
+};
+
+// State of the controls at the start of a simulation tick. Everything the
+// simulation reads from the player's continuous input is in here
+struct InputSnapshot {
+    Uint32 held;
+    // mouse position in screen pixels
+    Sint32 mouseX, mouseY;
+
+    int moveX() const { return ( ( this->held & INPUT_RIGHT ) ? 1 : 0 ) - ( ( this->held & INPUT_LEFT ) ? 1 : 0 ); };
+    int moveY() const { return ( ( this->held & INPUT_DOWN ) ? 1 : 0 ) - ( ( this->held & INPUT_UP ) ? 1 : 0 ); };
+};
+
+// one-off actions, queued in the order they happened
+enum CommandType {
+    CMD_QUIT,
+    CMD_ZOOM,               // value is the number of zoom steps, negative zooms out
+    CMD_CYCLE_RENDERER,
+    CMD_TOGGLE_INCREMENTAL,
+    CMD_SAVE_WORLD,
+    CMD_TARGETS_RESET,      // render target textures lost their content
+    CMD_UNDO,
+    CMD_REDO,
+    CMD_BRUSH,              // value is the change of the brush radius in tiles
+    CMD_TOGGLE_STATS
+};
+
+struct Command {
+    Uint32 type;
+    Sint32 value;
+};
+
+// Turns SDL events into the current InputSnapshot and a queue of commands.
+// Translating an event only updates state; nothing is printed or drawn, and
+// the simulation never sees raw events, so the same snapshots and commands
+// can be produced without a window
+class InputSystem {
+public:
+    InputSystem();
+    void handleEvent( const SDL_Event& e );
+    void push( const Command& command );
+    bool pollCommand( Command& command );
+
+    const InputSnapshot& snapshot() { return this->state; };
+private:
+    void setHeld( Uint32 button, bool down );
+
+    InputSnapshot state;
+    std::deque<Command> commands;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include <stdio.h>
+
+#include "inputlog.h"
+
+InputLog::InputLog()
+{
+    this->header = { inputlog_constants::magic, inputlog_constants::version, 0, 0, 0, 0, 0, 0 };
+    this->framedCommands = 0;
+}
+void InputLog::addCommand( const Command& command )
+{
+    // belongs to the next frame added
+    this->commands.push_back( command );
+}
+void InputLog::addFrame( const InputSnapshot& input, int ticks, double alpha, const SDL_Rect& view, double zoom, double frameMs )
+{
+    InputLogFrame frame;
+    frame.held = input.held;
+    frame.mouseX = input.mouseX;
+    frame.mouseY = input.mouseY;
+    frame.camX = view.x;
+    frame.camY = view.y;
+    frame.zoom = zoom;
+    frame.alpha = alpha;
+    frame.frameMs = frameMs;
+    frame.ticks = ticks;
+    frame.commandCount = this->commands.size() - this->framedCommands;
+    this->framedCommands = this->commands.size();
+    this->frames.push_back( frame );
+}
+bool InputLog::write( const char* path )
+{
+    this->header.frameCount = this->frames.size();
+    this->header.commandCount = this->commands.size();
+    FILE* f = fopen( path, "wb" );
+    if ( f == NULL ) {
+        printf( "Unable to open %s for writing!\n", path );
+        return false;
+    }
+    bool ok = fwrite( &this->header, sizeof( this->header ), 1, f ) == 1 &&
+              fwrite( this->frames.data(), sizeof( InputLogFrame ), this->frames.size(), f ) == this->frames.size() &&
+              fwrite( this->commands.data(), sizeof( Command ), this->commands.size(), f ) == this->commands.size();
+    ok = ( fclose( f ) == 0 ) && ok;
+    if ( !ok ) {
+        printf( "Unable to write input log %s!\n", path );
+    }
+    return ok;
+}
+bool InputLog::read( const char* path )
+{
+    FILE* f = fopen( path, "rb" );
+    if ( f == NULL ) {
+        printf( "Unable to open input log %s!\n", path );
+        return false;
+    }
+    bool ok = fread( &this->header, sizeof( this->header ), 1, f ) == 1 &&
+              this->header.magic == inputlog_constants::magic &&
+              this->header.version == inputlog_constants::version;
+    if ( ok ) {
+        this->frames.resize( this->header.frameCount );
+        this->commands.resize( this->header.commandCount );
+        ok = fread( this->frames.data(), sizeof( InputLogFrame ), this->frames.size(), f ) == this->frames.size() &&
+             fread( this->commands.data(), sizeof( Command ), this->commands.size(), f ) == this->commands.size();
+    }
+    fclose( f );
+    if ( !ok ) {
+        printf( "Unable to read input log %s!\n", path );
+    }
+    return ok;
+}
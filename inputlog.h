@@ -0,0 +1,66 @@
+#ifndef FERMI_INPUTLOG_H
+#define FERMI_INPUTLOG_H
+
+#include <vector>
+
+#include "common.h"
+#include "input.h"
+
+// Binary log of a play session: a header, one InputLogFrame per frame, then
+// the commands of all frames in order. Written in native byte order.
+//
+//   InputLogHeader
+//   InputLogFrame[ frameCount ]
+//   Command[ commandCount ]
+
+namespace inputlog_constants {
+    const Uint32 magic = 0x4E495046;    // "FPIN"
+    const Uint32 version = 1;
+};
+
+struct InputLogHeader {
+    Uint32 magic;
+    Uint32 version;
+    // what the world and the renderer were started with
+    Uint32 seed;
+    Uint32 chunkLength;
+    Uint32 renderer;
+    Uint32 incremental;
+    Uint32 frameCount;
+    Uint32 commandCount;
+};
+
+struct InputLogFrame {
+    // input snapshot used by every tick of the frame
+    Uint32 held;
+    Sint32 mouseX, mouseY;
+    // camera box drawn, so a replay can check it follows the same path
+    Sint32 camX, camY;
+    float zoom;
+    // fraction of a tick the camera was interpolated by
+    double alpha;
+    // how long the frame took when it was recorded
+    float frameMs;
+    // fixed simulation ticks run this frame and commands applied before them
+    Uint16 ticks;
+    Uint16 commandCount;
+};
+
+// Collects frames while recording, or holds a log read back for replay
+class InputLog {
+public:
+    InputLog();
+    void addCommand( const Command& command );
+    void addFrame( const InputSnapshot& input, int ticks, double alpha, const SDL_Rect& view, double zoom, double frameMs );
+    bool write( const char* path );
+    bool read( const char* path );
+
+    InputLogHeader header;
+    std::vector<InputLogFrame> frames;
+    std::vector<Command> commands;
+private:
+    // commands already assigned to a frame
+    size_t framedCommands;
+};
+
+#endif
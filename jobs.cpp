@@ -0,0 +1,179 @@
+#include <algorithm>
+
+#include "jobs.h"
+
+namespace {
+    // the pool and queue index of the worker running on this thread
+    thread_local JobSystem* currentSystem = NULL;
+    thread_local int currentIndex = -1;
+};
+
+JobSystem::JobSystem( int threads )
+    : queued( 0 ), nextQueue( 0 ), executed( 0 ), stolen( 0 ), helped( 0 )
+{
+    this->stopping = false;
+    if ( threads < 1 ) {
+        threads = 1;
+    }
+    for ( int i=0; i<threads; i++ ) {
+        this->queues.push_back( std::unique_ptr<Queue>( new Queue() ) );
+    }
+    for ( int i=0; i<threads; i++ ) {
+        this->workers.push_back( std::thread( &JobSystem::workerLoop, this, i ) );
+    }
+}
+JobSystem::~JobSystem()
+{
+    // queued jobs are dropped, running ones finish first
+    this->cancelQueued();
+    {
+        std::lock_guard<std::mutex> lock( this->sleepMutex );
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for ( size_t i=0; i<this->workers.size(); i++ ) {
+        this->workers[ i ].join();
+    }
+}
+JobStats JobSystem::stats()
+{
+    return { this->executed.load(), this->stolen.load(), this->helped.load() };
+}
+void JobSystem::submit( Job job, JobGroup* group )
+{
+    if ( group != NULL ) {
+        group->remaining++;
+    }
+    // counted together with the push under the queue lock, so while queued is
+    // above 0 a take() finds a job and waiters sleep rather than spin
+    if ( currentSystem == this ) {
+        Queue& queue = *this->queues[ currentIndex ];
+        std::lock_guard<std::mutex> lock( queue.mutex );
+        queue.jobs.push_front( std::make_pair( std::move( job ), group ) );
+        this->queued++;
+    }
+    else {
+        Queue& queue = *this->queues[ this->nextQueue++ % this->queues.size() ];
+        std::lock_guard<std::mutex> lock( queue.mutex );
+        queue.jobs.push_back( std::make_pair( std::move( job ), group ) );
+        this->queued++;
+    }
+    // queued is raised before this lock is taken, so a worker checking it
+    // under the lock either sees the job or is already waiting for the notify
+    {
+        std::lock_guard<std::mutex> lock( this->sleepMutex );
+    }
+    this->wake.notify_one();
+}
+void JobSystem::cancelQueued()
+{
+    // drop every job that has not started; their groups count them as done
+    for ( size_t i=0; i<this->queues.size(); i++ ) {
+        std::deque<std::pair<Job, JobGroup*>> dropped;
+        {
+            std::lock_guard<std::mutex> lock( this->queues[ i ]->mutex );
+            dropped.swap( this->queues[ i ]->jobs );
+            this->queued -= dropped.size();
+        }
+        for ( size_t j=0; j<dropped.size(); j++ ) {
+            if ( dropped[ j ].second != NULL ) {
+                dropped[ j ].second->remaining--;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock( this->sleepMutex );
+    this->groupDone.notify_all();
+}
+bool JobSystem::take( int index, std::pair<Job, JobGroup*>& job )
+{
+    // own deque first, then the others starting with the next one. index is
+    // -1 for a thread outside the pool helping in wait(); what it takes is
+    // counted as helped, not stolen
+    int count = this->queues.size();
+    if ( index >= 0 ) {
+        Queue& own = *this->queues[ index ];
+        std::lock_guard<std::mutex> lock( own.mutex );
+        if ( !own.jobs.empty() ) {
+            job = std::move( own.jobs.front() );
+            own.jobs.pop_front();
+            this->queued--;
+            return true;
+        }
+    }
+    for ( int i=1; i<=count; i++ ) {
+        int victim = ( std::max( index, 0 ) + i ) % count;
+        if ( victim == index ) {
+            continue;
+        }
+        Queue& queue = *this->queues[ victim ];
+        std::lock_guard<std::mutex> lock( queue.mutex );
+        if ( !queue.jobs.empty() ) {
+            job = std::move( queue.jobs.back() );
+            queue.jobs.pop_back();
+            this->queued--;
+            if ( index >= 0 ) {
+                this->stolen++;
+            }
+            else {
+                this->helped++;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+void JobSystem::run( std::pair<Job, JobGroup*>& job )
+{
+    job.first();
+    this->executed++;
+    if ( job.second != NULL && --job.second->remaining == 0 ) {
+        std::lock_guard<std::mutex> lock( this->sleepMutex );
+        this->groupDone.notify_all();
+    }
+}
+void JobSystem::wait( JobGroup& group )
+{
+    // help with any queued job until the group is done, so waiting from inside
+    // a job or with every worker busy cannot deadlock
+    int index = currentSystem == this ? currentIndex : -1;
+    while ( group.remaining > 0 ) {
+        std::pair<Job, JobGroup*> job;
+        if ( this->take( index, job ) ) {
+            this->run( job );
+            continue;
+        }
+        std::unique_lock<std::mutex> lock( this->sleepMutex );
+        this->groupDone.wait( lock, [&]() { return group.remaining == 0 || this->queued > 0; } );
+    }
+}
+void JobSystem::parallelFor( int count, const std::function<void( int, int )>& body )
+{
+    // split [ 0, count ) into ranges, a few per thread so a slow range is
+    // balanced by stealing, run body( begin, end ) on each and wait for all of
+    // them. The calling thread helps, so this also works from inside a job
+    int ranges = std::min( count, 4 * ( (int)this->workers.size() + 1 ) );
+    JobGroup group;
+    for ( int r=0; r<ranges; r++ ) {
+        int begin = (long)count * r / ranges;
+        int end = (long)count * ( r + 1 ) / ranges;
+        this->submit( [&body, begin, end]() { body( begin, end ); }, &group );
+    }
+    this->wait( group );
+}
+void JobSystem::workerLoop( int index )
+{
+    currentSystem = this;
+    currentIndex = index;
+    while ( true ) {
+        std::pair<Job, JobGroup*> job;
+        if ( this->take( index, job ) ) {
+            this->run( job );
+            continue;
+        }
+        std::unique_lock<std::mutex> lock( this->sleepMutex );
+        this->wake.wait( lock, [this]() { return this->stopping || this->queued > 0; } );
+        if ( this->stopping ) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef FERMI_JOBS_H
+#define FERMI_JOBS_H
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+typedef std::function<void()> Job;
+
+// Counts unfinished jobs submitted with it, so a caller can wait for just
+// those jobs
+struct JobGroup {
+    JobGroup() : remaining( 0 ) {};
+    std::atomic<int> remaining;
+};
+
+struct JobStats {
+    long executed;
+    // taken by a worker from another worker's deque
+    long stolen;
+    // run by a thread outside the pool while it waited
+    long helped;
+};
+
+// Fixed pool of worker threads, each with its own deque of jobs. Workers take
+// jobs from the front of their own deque and steal from the back of the
+// others' when it runs dry, so a thief takes the job its owner would have
+// reached last. Jobs submitted from outside the pool are dealt round robin in
+// order; jobs submitted by a running job go to the front of its worker's deque
+// and run next.
+class JobSystem {
+public:
+    JobSystem( int threads );
+    ~JobSystem();
+    void submit( Job job, JobGroup* group = NULL );
+    void wait( JobGroup& group );
+    void parallelFor( int count, const std::function<void( int, int )>& body );
+    void cancelQueued();
+
+    int threadCount() { return this->workers.size(); };
+    JobStats stats();
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::pair<Job, JobGroup*>> jobs;
+    };
+
+    bool take( int index, std::pair<Job, JobGroup*>& job );
+    void run( std::pair<Job, JobGroup*>& job );
+    void workerLoop( int index );
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> queued;
+    std::atomic<unsigned> nextQueue;
+    std::atomic<long> executed;
+    std::atomic<long> stolen;
+    std::atomic<long> helped;
+    // sleeping workers and waiters, guarded by sleepMutex
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable groupDone;
+    bool stopping;
+};
+
+#endif
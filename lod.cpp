@@ -0,0 +1,97 @@
+#include <algorithm>
+
+#include "lod.h"
+
+ChunkLod::ChunkLod( int length )
+{
+    this->len = length;
+    this->pixels.assign( length * length, 0 );
+    this->texture = NULL;
+    this->dirtyCol0 = 0;
+    this->dirtyCol1 = length;
+    this->dirtyRow0 = 0;
+    this->dirtyRow1 = length;
+}
+ChunkLod::~ChunkLod()
+{
+    this->releaseTexture();
+}
+void ChunkLod::releaseTexture()
+{
+    if ( this->texture != NULL ) {
+        SDL_DestroyTexture( this->texture );
+        this->texture = NULL;
+    }
+    // a new texture needs every pixel uploaded again
+    this->dirtyCol0 = 0;
+    this->dirtyCol1 = this->len;
+    this->dirtyRow0 = 0;
+    this->dirtyRow1 = this->len;
+}
+namespace {
+    struct BakeKernel {
+        const Uint8* types;
+        Uint32* pixels;
+        int length;
+
+        template<int Len>
+        void run()
+        {
+            // a constant trip count lets the compiler unroll the whole chunk. The
+            // colors are copied so stores to pixels cannot alias them
+            const int len = ChunkLength<Len>::value( this->length );
+            Uint32 colors[ TILE_COUNT ];
+            std::copy( gTileColors, gTileColors + TILE_COUNT, colors );
+            for ( int i=0; i<len*len; i++ ) {
+                this->pixels[ i ] = colors[ this->types[ i ] ];
+            }
+        }
+    };
+}
+void ChunkLod::bake( Chunk& chunk )
+{
+    BakeKernel kernel = { chunk.data(), this->pixels.data(), this->len };
+    dispatchChunkLength( this->len, kernel );
+    this->dirtyCol0 = 0;
+    this->dirtyCol1 = this->len;
+    this->dirtyRow0 = 0;
+    this->dirtyRow1 = this->len;
+}
+void ChunkLod::setTile( int row, int col, Uint8 type )
+{
+    // only the changed pixels are uploaded on the next render
+    this->pixels[ row*this->len + col ] = gTileColors[ type ];
+    if ( this->dirtyCol0 >= this->dirtyCol1 ) {
+        this->dirtyCol0 = col;
+        this->dirtyCol1 = col + 1;
+        this->dirtyRow0 = row;
+        this->dirtyRow1 = row + 1;
+    }
+    else {
+        this->dirtyCol0 = std::min( this->dirtyCol0, col );
+        this->dirtyCol1 = std::max( this->dirtyCol1, col + 1 );
+        this->dirtyRow0 = std::min( this->dirtyRow0, row );
+        this->dirtyRow1 = std::max( this->dirtyRow1, row + 1 );
+    }
+}
+void ChunkLod::render( SDL_Renderer* renderer, const SDL_Rect& dst )
+{
+    if ( this->texture == NULL ) {
+        this->texture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, this->len, this->len );
+        if ( this->texture == NULL ) {
+            printf( "Unable to create chunk LOD texture! SDL Error: %s\n", SDL_GetError() );
+            return;
+        }
+    }
+    if ( this->dirtyCol0 < this->dirtyCol1 ) {
+        SDL_Rect dirty = { this->dirtyCol0, this->dirtyRow0,
+                           this->dirtyCol1 - this->dirtyCol0, this->dirtyRow1 - this->dirtyRow0 };
+        SDL_UpdateTexture( this->texture, &dirty,
+                           &this->pixels[ this->dirtyRow0*this->len + this->dirtyCol0 ],
+                           this->len * sizeof( Uint32 ) );
+        this->dirtyCol0 = this->dirtyCol1 = 0;
+        this->dirtyRow0 = this->dirtyRow1 = 0;
+    }
+    SDL_RenderCopy( renderer, this->texture, NULL, &dst );
+    gDrawCalls++;
+}
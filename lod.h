@@ -0,0 +1,31 @@
+#ifndef FERMI_LOD_H
+#define FERMI_LOD_H
+
+#include <vector>
+
+#include "common.h"
+#include "tile.h"
+
+// Low resolution image of a chunk with one pixel per tile, drawn instead of
+// the tiles when zoomed far out. The pixels are baked on any thread; the
+// texture is created and updated on the render thread when it is first drawn
+class ChunkLod {
+public:
+    ChunkLod( int length );
+    ~ChunkLod();
+    void bake( Chunk& chunk );
+    void setTile( int row, int col, Uint8 type );
+    void render( SDL_Renderer* renderer, const SDL_Rect& dst );
+    void releaseTexture();
+
+    // one color per tile in the same order as the chunk's types
+    const Uint32* data() { return this->pixels.data(); };
+private:
+    int len;
+    std::vector<Uint32> pixels;
+    SDL_Texture* texture;
+    // tiles changed since the last upload, as a half open rect of columns and rows
+    int dirtyCol0, dirtyCol1, dirtyRow0, dirtyRow1;
+};
+
+#endif
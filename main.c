@@ -2,22 +2,27 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
-#include <SDL2/SDL.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 
+#include "core.h"
+
 // global variables
 const int SCREEN_WIDTH = 1280;
 const int SCREEN_HEIGHT = 720;
 
-const int TILE_W = 32;
-const int TILE_H = 32;
+const int TILE_W = FERMI_TILE_WIDTH;
+const int TILE_H = FERMI_TILE_HEIGHT;
 
-const int TILE_GRASS = 0;
-const int TILE_METAL = 1;
+const int TILE_GRASS = FERMI_TILE_GRASS;
+const int TILE_METAL = FERMI_TILE_METAL;
 
-SDL_Rect gTileClips[ 2 ];
+// the engine library draws with these, like the C++ front-end's
+SDL_Rect gTileClips[ FERMI_TILE_COUNT ];
+Uint32 gTileColors[ FERMI_TILE_COUNT ];
+int gDrawCalls = 0;
+int gTilesDrawn = 0;
 
 SDL_Window* gWindow = NULL;
 SDL_Renderer* gRenderer = NULL;
@@ -55,15 +60,6 @@ bool initSDL()
     return success;
 }
 
-bool checkCollision( SDL_Rect A, SDL_Rect B )
-{
-    // if A is outside of B
-    if ( A.x >= B.x+B.w || A.x+A.w <= B.x || A.y >= B.y+B.h || A.y+A.h <= B.y ) {
-        return false;
-    }
-    return true;
-}
-
 SDL_Texture* loadTexture( SDL_Renderer* renderer, char* path )
 {
     // load a texture from file into a renderer. Return NULL on failure
@@ -107,155 +103,57 @@ SDL_Texture* loadTextTexture( char* textureText, SDL_Color textColor )
 }
 
 
-struct Camera {
-    SDL_Rect box;
-    float x, y;
-    float velX, velY;
-		float speed;
-    bool zoomedThisTick;
-    float zoom;
-};
-typedef struct Camera Camera;
-
-Camera createCamera( int w, int h )
-{
-	Camera cam;
-  cam.box.x = 0;
-  cam.box.y = 0;
-  cam.box.w = w;
-  cam.box.h = h;
-  cam.x = 0;
-  cam.y = 0;
-  cam.velX = 0;
-  cam.velY = 0;
-	cam.speed = 8.f;
-	cam.zoomedThisTick = false;
-	cam.zoom = 0.5f;
-	return cam;
-}
-
-void moveCam(Camera* cam)
-{
-    cam->x += cam->velX;
-    cam->y += cam->velY;
-    cam->box.x = (int) cam->x;
-    cam->box.y = (int) cam->y;
-};
-
-float getCamZoom(Camera* cam) { return cam->zoom; };
-
-SDL_Rect getCamRect(Camera* cam) { return cam->box; };
-
-void handleCamEvent( SDL_Event* e, Camera* cam )
+void handleCamEvent( SDL_Event* e, FermiCamera* cam, int* moveX, int* moveY )
 {
-    cam->zoomedThisTick = false;
     // if an arrow key is pressed
     if ( e->type == SDL_KEYDOWN && e->key.repeat == 0 ) {
         switch ( e->key.keysym.sym )
-				{
-						case SDLK_UP:
-                cam->velY = -cam->speed;
+        {
+            case SDLK_UP:
+                *moveY = -1;
                 break;
             case SDLK_DOWN:
-                cam->velY = cam->speed;
+                *moveY = 1;
                 break;
             case SDLK_RIGHT:
-                cam->velX = cam->speed;
+                *moveX = 1;
                 break;
             case SDLK_LEFT:
-                cam->velX = -cam->speed;
+                *moveX = -1;
                 break;
         }
     }
     // if an arrow key is released
     else if ( e->type == SDL_KEYUP && e->key.repeat == 0 ) {
         if ( e->key.keysym.sym == SDLK_UP || e->key.keysym.sym == SDLK_DOWN ) {
-            cam->velY = 0;
+            *moveY = 0;
         }
         else if ( e->key.keysym.sym == SDLK_LEFT || e->key.keysym.sym == SDLK_RIGHT ) {
-            cam->velX = 0;
+            *moveX = 0;
         }
     }
     // if mouse scroll
-    if ( e->wheel.y == 1 ) { // scroll up
-        cam->zoom += 0.025;
-        if ( cam->zoom > 1.0 ) {
-            cam->zoom = 1.0;
-        }
-        cam->zoomedThisTick = true;
-        printf("zoom: %f\n", cam->zoom);
+    else if ( e->type == SDL_MOUSEWHEEL && e->wheel.y != 0 ) {
+        // one step per notch, positive is scroll up
+        fermiCameraZoomBy( cam, e->wheel.y );
     }
-    else if ( e->wheel.y == -1 ) { // scroll down
-        cam->zoom -= 0.025;
-        if ( cam->zoom <= 0.0 ) {
-            cam->zoom = 0.025;
-        }
-        cam->zoomedThisTick = true;
-        printf("zoom: %f\n", cam->zoom);
-    }
-};
-
-struct Tile {
-    int type;
-    SDL_Rect rect;
-};
-typedef struct Tile Tile;
-
-Tile createTile(int x, int y, int type)
-{
-		Tile tile;
-    tile.rect.x = x;
-    tile.rect.y = y;
-    tile.rect.w = TILE_W;
-    tile.rect.h = TILE_H;
-    tile.type = type;
-		return tile;
+    fermiCameraInput( cam, *moveX, *moveY );
 }
 
-void renderTile( SDL_Rect* camRect, Tile* tile )
+void renderChunk( SDL_Rect* camRect, Uint8* chunk, int length )
 {
-    if ( checkCollision( tile->rect, *camRect ) ) {
-        SDL_Rect dstRect = { tile->rect.x - camRect->x,
-                             tile->rect.y - camRect->y,
-                             tile->rect.w,
-                             tile->rect.h
-                           };
-        SDL_RenderCopy( gRenderer, gTileTexture, &gTileClips[ tile->type ], &dstRect );
+    // the chunk's origin is at the world origin; only the rows and columns
+    // overlapping the camera are walked
+    int row0, row1, col0, col1;
+    if ( !visibleTileRange( *camRect, 0, 0, length, &row0, &row1, &col0, &col1 ) ) {
+        return;
     }
-		return;
-}
-
-void applyTileZoom( int row, int col, float zoomLevel, Tile* tile )
-{
-    tile->rect.w = TILE_W * zoomLevel;
-    tile->rect.h = TILE_H * zoomLevel;
-    tile->rect.x = tile->rect.w * col;
-    tile->rect.y = tile->rect.h * row;
-		return;
-}
-
-int getWidth(Tile* tile) { return tile->rect.w; }
-
-int getType(Tile* tile) { return tile->type; }
-
-void loadChunk( Tile* chunk, int length )
-{
-    for ( int i=0; i<length; i++ ) {
-        int y = i * TILE_W;
-        for ( int j=0; j<length; j++ ) {
-            int x = j * TILE_H;
-            chunk[i*length + j] = createTile(x, y, rand()%2);
-        }
-    }
-}
-
-void zoomChunk(Tile* chunk, int length, float zoomLevel)
-{
-		return;
-    for ( int i=0; i<length; i++ ) {
-        for ( int j=0; j<length; j++ ) {
-						Tile tile = chunk[i*length + j];
-						applyTileZoom(i, j, zoomLevel, &tile);
+    SDL_Rect dstRect = { 0, 0, TILE_W, TILE_H };
+    for ( int i=row0; i<row1; i++ ) {
+        dstRect.y = i * TILE_H - camRect->y;
+        for ( int j=col0; j<col1; j++ ) {
+            dstRect.x = j * TILE_W - camRect->x;
+            SDL_RenderCopy( gRenderer, gTileTexture, &gTileClips[ chunk[i*length + j] ], &dstRect );
         }
     }
 }
@@ -297,24 +195,27 @@ int main( int argc, char* argv[] )
         return 3;
     }
 
-		int chunk_size = 64;
+		int chunk_size = FERMI_CHUNK_LENGTH;
 
     gTileTexture = loadTexture( gRenderer, "textures/tilesSpritesheet.png" );
-    Tile* chunk;
-		chunk = malloc(sizeof(Tile) * chunk_size * chunk_size);
+    Uint8* chunk;
+		chunk = malloc(chunk_size * chunk_size);
 
     setClips();
     printf("Clips set.\n");
-    loadChunk(chunk, chunk_size);
+    // same terrain as the C++ front-end's default seed
+    fermiGenerateChunk(1, 0, 0, chunk_size, chunk);
     printf("Chunk loaded.\n");
 
-    Camera camera = createCamera(SCREEN_WIDTH,SCREEN_HEIGHT);
+    FermiCamera* camera = fermiCreateCamera(SCREEN_WIDTH,SCREEN_HEIGHT);
+    int moveX = 0, moveY = 0;
     SDL_Event e;
     char FPSText[16];
     SDL_Color FPStextColor = { 255, 255, 0, 255 };
     int frameNumber = 0;
 
-    const Uint32 FPSStart = SDL_GetTicks();
+    Uint32 FPSStart = SDL_GetTicks();
+    float FPSTime = 0.f;
 
     // Main loop
     bool quit = false;
@@ -324,23 +225,28 @@ int main( int argc, char* argv[] )
         // Handle event queue
         while ( SDL_PollEvent( &e ) != 0 ) {
             if ( e.type == SDL_QUIT ) { quit = true; }
-            if ( e.key.keysym.sym == SDLK_ESCAPE ) { quit = true; }
-            handleCamEvent(&e, &camera);
+            if ( e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE ) { quit = true; }
+            handleCamEvent(&e, camera, &moveX, &moveY);
         }
 
 
         // Set positions/game state
-        float FPSTime = frameNumber / ((SDL_GetTicks() - FPSStart) / 1000.f);
-        if ( FPSTime > 2000000.f ) {
-            FPSTime = 0.f;
-        }
-        //FPSText << "FPS: " << FPSTime;
-				snprintf(FPSText, sizeof(FPSText), "FPS: %.1f", FPSTime);
-        gFPSTexture = loadTextTexture( FPSText, FPStextColor );
-				moveCam(&camera);
-        if ( camera.zoomedThisTick ) {
-            zoomChunk( chunk, 64, getCamZoom(&camera)*2.5 );
+        // average over the frames of the last second. The text texture is
+        // only rebuilt when the text changes, and the old one freed
+        Uint32 FPSElapsed = SDL_GetTicks() - FPSStart;
+        if ( FPSElapsed >= 1000 || gFPSTexture == NULL ) {
+            if ( FPSElapsed >= 1000 ) {
+                FPSTime = frameNumber * 1000.f / FPSElapsed;
+                FPSStart = SDL_GetTicks();
+                frameNumber = 0;
+            }
+            snprintf(FPSText, sizeof(FPSText), "FPS: %.1f", FPSTime);
+            if ( gFPSTexture != NULL ) {
+                SDL_DestroyTexture( gFPSTexture );
+            }
+            gFPSTexture = loadTextTexture( FPSText, FPStextColor );
         }
+				fermiCameraMove(camera);
 
 
         // Clear the renderer
@@ -349,11 +255,10 @@ int main( int argc, char* argv[] )
 
 
         // Draw objects to renderer
-        for ( int i=0; i < 64*64; i++ ) {
-            //chunk[i].render( getCamRect(&camera) );
-						SDL_Rect cam_rect = getCamRect(&camera);
-            renderTile(&cam_rect, &chunk[i]);
-        }
+        SDL_Rect cam_rect = fermiCameraRect(camera);
+        SDL_RenderSetScale( gRenderer, fermiCameraZoom(camera), fermiCameraZoom(camera) );
+        renderChunk(&cam_rect, chunk, chunk_size);
+        SDL_RenderSetScale( gRenderer, 1.f, 1.f );
         //SDL_SetRenderDrawColor( gRenderer, 0xFF, 0, 0, 0xFF );
         //SDL_RenderDrawRect( gRenderer, &camera.rect() ); // draw cam in red
         SDL_Rect FPSTextPos = { 0, 0, 200, 50 };
@@ -371,6 +276,13 @@ int main( int argc, char* argv[] )
         }
     }
 
+    fermiDestroyCamera(camera);
+    if ( gFPSTexture != NULL ) {
+        SDL_DestroyTexture( gFPSTexture );
+    }
+    if ( gTileTexture != NULL ) {
+        SDL_DestroyTexture( gTileTexture );
+    }
     SDL_Quit();
 		free(chunk);
     printf( "SDL quit successfully.\n" );
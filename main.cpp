@@ -1,80 +1,59 @@
 #include <stdio.h>
-#include <stdlib.h> // rand
-#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <vector>
-#include <sstream>
+#include <algorithm>
+#include <thread>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 
-struct vec2 {
-    double x;
-    double y;
+#include "common.h"
+#include "camera.h"
+#include "tile.h"
+#include "world.h"
+#include "hud.h"
+#include "profiler.h"
+#include "atlas.h"
+#include "framecache.h"
+#include "input.h"
+#include "inputlog.h"
+#include "editor.h"
+#include "framestats.h"
+#include "entities.h"
+#include "pipeline.h"
 
-    vec2( double x=0, double y=0 ) : x(x), y(y)
-    {
-    }
-
-    vec2 operator=( const vec2& other )
-    {
-        x = other.x;
-        y = other.y;
-        return *this;
-    }
-
-    vec2 operator+( const vec2& other ) const
-    {
-        return vec2( x + other.x, y + other.y );
-    }
-
-    vec2 operator-( const vec2& other ) const
-    {
-        return vec2( x - other.x, y - other.y );
-    }
-
-    bool operator==( const vec2& other ) const
-    {
-        return ( other.x == x && other.y == y );
-    }
-
-    double norm()
-    {
-        return sqrt( x*x + y*y );
-    }
-
-    double dotProd( vec2 other )
-    {
-        return x * other.x + y * other.y;
-    }
-
-    std::string str()
-    {
-        return "(" + std::to_string(x) + "," + std::to_string(y) + ")";
-    }
-};
-
-// global variables
-const int SCREEN_WIDTH = 1280;
-const int SCREEN_HEIGHT = 720;
-
-const int TILE_W = 32;
-const int TILE_H = 32;
-
-const int TILE_GRASS = 0;
-const int TILE_METAL = 1;
-
-SDL_Rect gTileClips[ 2 ];
+SDL_Rect gTileClips[ TILE_COUNT ];
+Uint32 gTileColors[ TILE_COUNT ];
 
 SDL_Window* gWindow = NULL;
 SDL_Renderer* gRenderer = NULL;
 SDL_Texture* gTileTexture = NULL;
-SDL_Texture* gFPSTexture = NULL;
 TTF_Font* gFont = NULL;
 
-bool init()
+// number of draw calls submitted to the renderer in the current frame
+int gDrawCalls = 0;
+// number of tiles drawn in the current frame
+int gTilesDrawn = 0;
+
+// how the main loop paces frames
+enum FramePacing {
+    PACING_CAPPED,      // sleep to hold 60 FPS
+    PACING_UNCAPPED,    // render as fast as possible
+    PACING_VSYNC        // let SDL_RenderPresent wait for the display
+};
+
+namespace loop_constants {
+    // the simulation always advances in steps of this length
+    const double tickSeconds = 1.0 / 60.0;
+    // longest frame fed into the simulation, so a stall does not cause a burst of ticks
+    const double maxFrameSeconds = 0.25;
+};
+
+bool init( bool vsync )
 {
     // initializes SDL and creates a global window and renderer
     bool success = true;
@@ -91,7 +70,11 @@ bool init()
         printf( "Error creating window\n" );
         success = false;
     }
-    gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED );
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if ( vsync ) {
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    gRenderer = SDL_CreateRenderer( gWindow, -1, rendererFlags );
     if ( gRenderer == NULL ) {
         printf( "Error creating renderer\n" );
         success = false;
@@ -104,34 +87,32 @@ bool init()
     return success;
 }
 
-bool checkCollision( SDL_Rect A, SDL_Rect B )
+bool initHeadless()
 {
-    // if A is outside of B
-    if ( A.x >= B.x+B.w || A.x+A.w <= B.x || A.y >= B.y+B.h || A.y+A.h <= B.y ) {
+    // initializes SDL without a display: the dummy video driver handles events
+    // and a software renderer draws into an offscreen surface
+    bool success = true;
+    SDL_SetHint( SDL_HINT_VIDEODRIVER, "dummy" );
+    if ( SDL_Init( SDL_INIT_VIDEO ) != 0 ) {
+        printf( "Error initializing SDL: %s\n", SDL_GetError() );
+        success = false;
+    }
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA8888 );
+    if ( target == NULL ) {
+        printf( "Error creating offscreen surface: %s\n", SDL_GetError() );
         return false;
     }
-    return true;
-}
-
-SDL_Texture* loadTexture( SDL_Renderer* renderer, std::string path )
-{
-    // load a texture from file into a renderer. Return NULL on failure
-    SDL_Texture* loadedTexture = NULL;
-    SDL_Surface* surf = IMG_Load( path.c_str() );
-    if ( surf == NULL ) {
-        printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), SDL_GetError() );
-        return NULL;
+    gRenderer = SDL_CreateSoftwareRenderer( target );
+    if ( gRenderer == NULL ) {
+        printf( "Error creating software renderer: %s\n", SDL_GetError() );
+        success = false;
     }
-    else {
-        loadedTexture = SDL_CreateTextureFromSurface( renderer, surf );
-        if ( loadedTexture == NULL ) {
-            printf( "Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
-            return NULL;
-        }
-        SDL_FreeSurface( surf );
+    if ( TTF_Init() == -1 ) {
+        printf( "Error initializing SDL_ttf! SDL_ttf Error: %s\n", TTF_GetError() );
+        success = false;
     }
 
-    return loadedTexture;
+    return success;
 }
 
 SDL_Texture* loadTextTexture( std::string textureText, SDL_Color textColor )
@@ -155,172 +136,694 @@ SDL_Texture* loadTextTexture( std::string textureText, SDL_Color textColor )
     return loadedTexture;
 }
 
-namespace camera_constants {
-    const double baseCamSpeed = 8.0;
+// sprite sheets packed into the tile atlas. The tile sheet comes first, so
+// its frames are sprites 0 and up
+const AtlasSheet atlasSheets[] = {
+    { "textures/tilesSpritesheet.png", TILE_W, TILE_H },
+    { "textures/hexagons.png", 0, 0 },
 };
+const char* atlasCachePath = "textures/atlas.cache";
+// atlas sprite drawn for each tile type
+const int tileSprites[ TILE_COUNT ] = { 0, 1 };
 
-class Camera {
-public:
-    Camera( int w, int h );
-    ~Camera();
-    void handleEvent( SDL_Event& e );
-    void move();
-
-    vec2 getPos() { return this->pos; };
-    SDL_Rect& rect() { return this->box; };
-    SDL_Texture* texture() { return camTexture; };
-private:
-    SDL_Texture* camTexture;
-    double camSpeed;
-    SDL_Rect box;
-    vec2 pos;
-    double velX, velY;
-    double zoom;
-};
-Camera::Camera( int w, int h )
+bool loadTileAtlas( TextureAtlas& atlas )
 {
-    this->camTexture = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT );
-    this->box.x = 0;
-    this->box.y = 0;
-    this->box.w = w;
-    this->box.h = h;
-    this->pos = vec2( 0.0, 0.0 );
-    this->velX = 0;
-    this->velY = 0;
-    this->camSpeed = 8.0;
-    this->zoom = 1.0;
+    // pack the sprite sheets, or load them from the cache, and point the tile
+    // clips and colors at the packed sprites
+    Uint64 start = SDL_GetPerformanceCounter();
+    if ( !atlas.load( atlasSheets, sizeof( atlasSheets ) / sizeof( atlasSheets[ 0 ] ), atlasCachePath ) ) {
+        return false;
+    }
+    gTileTexture = atlas.createTexture( gRenderer );
+    if ( gTileTexture == NULL ) {
+        return false;
+    }
+    for ( int type=0; type<TILE_COUNT; type++ ) {
+        gTileClips[ type ] = atlas.clip( tileSprites[ type ] );
+        gTileColors[ type ] = atlas.averageColor( tileSprites[ type ] );
+    }
+    double ms = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency();
+    printf( "Loaded %dx%d atlas with %d sprites from %s in %.2f ms\n", atlas.getWidth(), atlas.getHeight(),
+            atlas.spriteCount(), atlas.fromCache() ? "cache" : "PNG files", ms );
+    return true;
 }
-Camera::~Camera()
+
+bool loadMedia()
 {
-    SDL_DestroyTexture( this->camTexture );
+    gFont = TTF_OpenFont( "lazy.ttf", 28 );
+    if ( gFont == NULL ) {
+        printf( "Failed to load text font! SDL_ttf Error: %s\n", TTF_GetError() );
+        return false;
+    }
+    return true;
+}
+
+// how tiles are submitted to the renderer
+enum TileRenderer {
+    RENDER_PER_TILE,    // one SDL_RenderCopy per tile
+    RENDER_BATCHED,     // one SDL_RenderGeometry call per texture
+    RENDER_CACHED,      // one prebaked texture per chunk
+    RENDER_COUNT
+};
+
+const char* tileRendererNames[ RENDER_COUNT ] = { "per-tile", "batched", "cached" };
+
+// how a frame's simulation and culling are put together with drawing it
+enum PipelineMode {
+    PIPELINE_OFF,       // simulate, then draw with the tile renderer
+    PIPELINE_SERIAL,    // build a draw list, then submit it on the same thread
+    PIPELINE_THREADED,  // build the next frame's draw list while this one is submitted
+    PIPELINE_COUNT
+};
+
+const char* pipelineModeNames[ PIPELINE_COUNT ] = { "off", "serial", "threaded" };
+
+void drawWorld( ChunkManager& world, Camera& camera, TileBatch& tileBatch, TileRenderer renderer )
+{
+    // tiles are laid out at their world size relative to the camera and the
+    // renderer scales them by the camera zoom, so zooming never touches tiles
+    SDL_RenderSetScale( gRenderer, camera.getZoom(), camera.getZoom() );
+    switch ( renderer ) {
+        case RENDER_BATCHED:
+            world.render( camera, tileBatch );
+            tileBatch.flush( gRenderer );
+            break;
+        case RENDER_CACHED:
+            world.renderCached( camera, tileBatch );
+            break;
+        default:
+            world.render( camera );
+            break;
+    }
+    SDL_RenderSetScale( gRenderer, 1.0, 1.0 );
 }
-void Camera::handleEvent( SDL_Event& e )
+
+void buildDrawList( ChunkManager& world, Camera& camera, EntityWorld& entities, const SDL_Rect& entityClip, DrawList& list )
 {
-    // on arrow key pressed else released
-    if ( e.type == SDL_KEYDOWN && e.key.repeat == 0 ) {
-        switch ( e.key.keysym.sym ) {
-            case SDLK_UP:
-                this->velY = -this->camSpeed;
-                break;
-            case SDLK_DOWN:
-                this->velY = this->camSpeed;
-                break;
-            case SDLK_RIGHT:
-                this->velX = this->camSpeed;
-                break;
-            case SDLK_LEFT:
-                this->velX = -this->camSpeed;
-                break;
-        }
-    }
-    else if ( e.type == SDL_KEYUP && e.key.repeat == 0 ) {
-        if ( e.key.keysym.sym == SDLK_UP || e.key.keysym.sym == SDLK_DOWN ) {
-            this->velY = 0;
-        }
-        else if ( e.key.keysym.sym == SDLK_LEFT || e.key.keysym.sym == SDLK_RIGHT ) {
-            this->velX = 0;
-        }
-    }
-    // on mouse scroll up else down
-    if ( e.wheel.y == 1 ) {
-        this->zoom += 0.025;
-        if ( this->zoom > 1.0 ) {
-            this->zoom = 1.0;
-        }
-        this->box.w = SCREEN_WIDTH * this->zoom;
-        this->box.h = SCREEN_HEIGHT * this->zoom;
-        this->camSpeed = camera_constants::baseCamSpeed * this->zoom;
-        printf("zoom: %f camSpeed: %f\n", this->zoom, this->camSpeed );
-    }
-    else if ( e.wheel.y == -1 ) {
-        this->zoom -= 0.025;
-        if ( this->zoom <= 0.025 ) {
-            this->zoom = 0.025;
-        }
-        this->box.w = SCREEN_WIDTH * this->zoom;
-        this->box.h = SCREEN_HEIGHT * this->zoom;
-        this->camSpeed = camera_constants::baseCamSpeed * this->zoom;
-        printf("zoom: %f camSpeed: %f\n", this->zoom, this->camSpeed );
+    // what drawWorld and the entities would draw, recorded instead. Does not
+    // call the renderer, so it runs on the pipeline's thread
+    list.clear();
+    list.setScale( camera.getZoom() );
+    list.setNeedsWorld( !world.render( camera, list ) );
+    if ( entities.size() > 0 ) {
+        entities.render( camera, list, gTileTexture, entityClip );
     }
 }
-void Camera::move()
+
+void submitFrame( ChunkManager& world, Camera& camera, DrawList& list, FramePipeline& pipeline )
 {
-    this->pos.x += this->velX;
-    this->pos.y += this->velY;
-    this->box.x = round( this->pos.x );
-    this->box.y = round( this->pos.y );
+    // what the list left to the render thread is drawn while the producer is
+    // still idle and the camera is the one the list was built with. Then the
+    // next frame is started and this one submitted alongside it
+    SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+    SDL_RenderClear( gRenderer );
+    if ( list.needsWorld() ) {
+        SDL_RenderSetScale( gRenderer, camera.getZoom(), camera.getZoom() );
+        world.render( camera );
+        SDL_RenderSetScale( gRenderer, 1.0, 1.0 );
+    }
+    pipeline.start();
+    list.submit( gRenderer );
+    gTilesDrawn += list.tiles();
 }
 
-class Tile {
-public:
-    Tile( int x, int y, int type );
-    void render( Camera& cam );
+// one step of the scripted camera path used by --bench
+struct BenchStep {
+    int frames;         // number of frames the step lasts
+    SDL_Keycode key;    // arrow key held down during the step, 0 for none
+    int wheel;          // mouse wheel delta sent on every frame of the step
+};
 
-    int getType() { return this->type; };
-private:
-    int type;
-    SDL_Rect rect;
+const BenchStep benchScript[] = {
+    { 120, SDLK_RIGHT, 0 },
+    { 120, SDLK_DOWN, 0 },
+    { 39, 0, -1 },          // zoom all the way out
+    { 120, SDLK_LEFT, 0 },
+    { 120, SDLK_UP, 0 },
+    { 39, 0, 1 },           // and back in
+    { 60, 0, 0 }
 };
-Tile::Tile( int x, int y, int type )
+
+double percentile( std::vector<double>& sorted, double p )
 {
-    this->rect.x = x;
-    this->rect.y = y;
-    this->rect.w = TILE_W;
-    this->rect.h = TILE_H;
-    this->type = type;
+    size_t i = std::min( sorted.size() - 1, (size_t)( p * sorted.size() ) );
+    return sorted[ i ];
 }
-void Tile::render( Camera& cam )
+
+struct BenchResult {
+    double meanMs, p50Ms, p95Ms, p99Ms, maxMs;
+};
+
+void summarize( std::vector<double>& frameMs, BenchResult& result )
 {
-    if ( checkCollision( this->rect, cam.rect() ) ) {
-        SDL_Rect dstRect = { this->rect.x - cam.rect().x,
-                             this->rect.y - cam.rect().y,
-                             this->rect.w,
-                             this->rect.h
-                           };
-        SDL_RenderCopy( gRenderer, gTileTexture, &gTileClips[ this->type ], &dstRect );
+    // sorts frameMs
+    double totalMs = 0.0;
+    for ( size_t i=0; i<frameMs.size(); i++ ) {
+        totalMs += frameMs[ i ];
     }
+    std::sort( frameMs.begin(), frameMs.end() );
+    result.meanMs = totalMs / frameMs.size();
+    result.p50Ms = percentile( frameMs, 0.50 );
+    result.p95Ms = percentile( frameMs, 0.95 );
+    result.p99Ms = percentile( frameMs, 0.99 );
+    result.maxMs = frameMs.back();
 }
 
-void loadChunk( std::vector<Tile>& chunk, int length )
+int runBenchmark( ChunkManager& world, TileBatch& tileBatch, HudText& FPSLabel,
+                  TileRenderer renderer, bool incremental, int frames, BenchResult& result )
 {
-    for ( int i=0; i<length; i++ ) {
-        int y = i * TILE_W;
-        for ( int j=0; j<length; j++ ) {
-            int x = j * TILE_H;
-            chunk.push_back( Tile( x, y, rand()%2 ) );
+    // play the scripted camera path for a number of frames, one simulation
+    // tick per frame, and report how long each frame took to draw. Every run
+    // starts from a fresh camera so runs are comparable
+    Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
+    InputSystem input;
+    FrameCache frameCache( SCREEN_WIDTH, SCREEN_HEIGHT );
+    std::vector<SDL_Rect> worldChanges;
+    long redrawnPixels = 0;
+    const Uint64 perfFrequency = SDL_GetPerformanceFrequency();
+    const int stepCount = sizeof( benchScript ) / sizeof( benchScript[ 0 ] );
+    std::vector<double> frameMs;
+    frameMs.reserve( frames );
+    long drawCalls = 0, tilesDrawn = 0, tilesCulled = 0;
+
+    // generate the starting view up front so the first frames are comparable
+    world.update( camera );
+    while ( world.pendingChunks() > 0 ) {
+        SDL_Delay( 1 );
+        world.update( camera );
+    }
+
+    int step = 0, stepFrame = 0;
+    char FPSText[ 32 ];
+    for ( int frame=0; frame<frames; frame++ ) {
+        const BenchStep& s = benchScript[ step ];
+        SDL_Event e;
+        if ( stepFrame == 0 && s.key != 0 ) {
+            memset( &e, 0, sizeof( e ) );
+            e.type = SDL_KEYDOWN;
+            e.key.keysym.sym = s.key;
+            input.handleEvent( e );
         }
+        if ( s.wheel != 0 ) {
+            memset( &e, 0, sizeof( e ) );
+            e.type = SDL_MOUSEWHEEL;
+            e.wheel.y = s.wheel;
+            input.handleEvent( e );
+        }
+        Command command;
+        while ( input.pollCommand( command ) ) {
+            if ( command.type == CMD_ZOOM ) {
+                camera.zoomBy( command.value );
+            }
+        }
+
+        Uint64 frameBegin = SDL_GetPerformanceCounter();
+        {
+            PROFILE_ZONE( "frame" );
+            {
+                PROFILE_ZONE( "simulation" );
+                camera.applyInput( input.snapshot() );
+                camera.move();
+                world.update( camera );
+                world.takeChanges( worldChanges );
+                for ( size_t i=0; i<worldChanges.size(); i++ ) {
+                    frameCache.invalidateWorld( worldChanges[ i ] );
+                }
+            }
+
+            gDrawCalls = 0;
+            gTilesDrawn = 0;
+            {
+                PROFILE_ZONE( "tiles" );
+                bool drawn = incremental && frameCache.render( gRenderer, camera,
+                    [&]( Camera& view ) { drawWorld( world, view, tileBatch, renderer ); } );
+                if ( drawn ) {
+                    redrawnPixels += frameCache.redrawnPixels();
+                }
+                else {
+                    SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+                    SDL_RenderClear( gRenderer );
+                    drawWorld( world, camera, tileBatch, renderer );
+                    redrawnPixels += (long)SCREEN_WIDTH * SCREEN_HEIGHT;
+                }
+            }
+            drawCalls += gDrawCalls;
+            tilesDrawn += gTilesDrawn;
+            tilesCulled += (long)world.loadedChunks() * world.chunkLength() * world.chunkLength() - gTilesDrawn;
+            {
+                PROFILE_ZONE( "hud" );
+                snprintf( FPSText, sizeof( FPSText ), "Frame: %d", frame );
+                FPSLabel.setText( FPSText );
+                FPSLabel.render( gRenderer );
+            }
+            {
+                PROFILE_ZONE( "present" );
+                SDL_RenderPresent( gRenderer );
+            }
+        }
+        frameMs.push_back( ( SDL_GetPerformanceCounter() - frameBegin ) * 1000.0 / perfFrequency );
+
+        stepFrame++;
+        if ( stepFrame == s.frames ) {
+            if ( s.key != 0 ) {
+                memset( &e, 0, sizeof( e ) );
+                e.type = SDL_KEYUP;
+                e.key.keysym.sym = s.key;
+                input.handleEvent( e );
+            }
+            step = ( step + 1 ) % stepCount;
+            stepFrame = 0;
+        }
+    }
+
+    if ( frameMs.empty() ) {
+        return 1;
     }
+    summarize( frameMs, result );
+    ChunkCacheStats& cache = world.stats();
+    printf( "bench: %d frames, tile renderer: %s%s\n", frames, tileRendererNames[ renderer ], incremental ? ", incremental" : "" );
+    printf( "frame time ms: mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+            result.meanMs, result.p50Ms, result.p95Ms, result.p99Ms, result.maxMs );
+    printf( "per frame: draw calls %.1f, tiles drawn %.1f, tiles culled %.1f, screen redrawn %.1f%%\n",
+            (double)drawCalls / frames, (double)tilesDrawn / frames, (double)tilesCulled / frames,
+            100.0 * redrawnPixels / ( (double)frames * SCREEN_WIDTH * SCREEN_HEIGHT ) );
+    printf( "chunks: hits %ld misses %ld evictions %ld generated %ld\n",
+            cache.hits, cache.misses, cache.evictions, cache.generated );
+    return 0;
 }
 
-void setClips()
+struct PipelineBenchResult {
+    BenchResult frame;
+    // input read to present
+    BenchResult latency;
+    double framesPerSecond;
+};
+
+int runPipelineBenchmark( ChunkManager& world, HudText& FPSLabel, PipelineMode mode, int entityCount, Uint32 seed,
+                          const SDL_Rect& entityClip, int frames, PipelineBenchResult& result )
 {
-    // background clips
-    const int BG_TILE_W_PX = 32;
-    const int BG_TILE_H_PX = 32;
-    gTileClips[ TILE_GRASS ].x = 0;
-    gTileClips[ TILE_GRASS ].y = 0;
-    gTileClips[ TILE_GRASS ].w = BG_TILE_W_PX;
-    gTileClips[ TILE_GRASS ].h = BG_TILE_H_PX;
-    gTileClips[ TILE_METAL ].x = 0;
-    gTileClips[ TILE_METAL ].y = 32;
-    gTileClips[ TILE_METAL ].w = BG_TILE_W_PX;
-    gTileClips[ TILE_METAL ].h = BG_TILE_H_PX;
-    printf("Clips set\n");
+    // the scripted camera path of runBenchmark through draw lists, serial or
+    // threaded. Frame time runs from the start of one frame to the start of
+    // the next, waiting for the producer included; latency from reading the
+    // input a list was built from to presenting it
+    Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
+    InputSystem input;
+    EntityWorld entities;
+    entities.spawn( entityCount, seed );
+    std::vector<SDL_Rect> worldChanges;
+    const Uint64 perfFrequency = SDL_GetPerformanceFrequency();
+    const int stepCount = sizeof( benchScript ) / sizeof( benchScript[ 0 ] );
+    std::vector<double> frameMs, latencyMs;
+    frameMs.reserve( frames );
+    latencyMs.reserve( frames );
+    long drawCalls = 0, commands = 0;
+
+    world.update( camera );
+    while ( world.pendingChunks() > 0 ) {
+        SDL_Delay( 1 );
+        world.update( camera );
+    }
+
+    // the producer owns the camera and entities from start() until wait()
+    InputSnapshot producerInput = input.snapshot();
+    Uint64 producerInputTime = 0;
+    int producerZoom = 0;
+    double produceMs = 0.0;
+    FramePipeline pipeline( [&]( DrawList& list ) {
+        Uint64 begin = SDL_GetPerformanceCounter();
+        camera.zoomBy( producerZoom );
+        producerZoom = 0;
+        {
+            PROFILE_ZONE( "simulation" );
+            camera.applyInput( producerInput );
+            camera.move();
+            entities.tick( &world.workers() );
+        }
+        {
+            PROFILE_ZONE( "cull" );
+            buildDrawList( world, camera, entities, entityClip, list );
+        }
+        list.setInputTime( producerInputTime );
+        produceMs += ( SDL_GetPerformanceCounter() - begin ) * 1000.0 / perfFrequency;
+    }, mode == PIPELINE_THREADED );
+
+    int step = 0, stepFrame = 0;
+    char FPSText[ 32 ];
+    const Uint64 benchBegin = SDL_GetPerformanceCounter();
+    Uint64 frameBegin = benchBegin;
+    for ( int frame=0; frame<frames; frame++ ) {
+        pipeline.wait();
+        Uint64 now = SDL_GetPerformanceCounter();
+        if ( frame > 0 ) {
+            frameMs.push_back( ( now - frameBegin ) * 1000.0 / perfFrequency );
+        }
+        frameBegin = now;
+
+        const BenchStep& s = benchScript[ step ];
+        SDL_Event e;
+        if ( stepFrame == 0 && s.key != 0 ) {
+            memset( &e, 0, sizeof( e ) );
+            e.type = SDL_KEYDOWN;
+            e.key.keysym.sym = s.key;
+            input.handleEvent( e );
+        }
+        if ( s.wheel != 0 ) {
+            memset( &e, 0, sizeof( e ) );
+            e.type = SDL_MOUSEWHEEL;
+            e.wheel.y = s.wheel;
+            input.handleEvent( e );
+        }
+        Command command;
+        while ( input.pollCommand( command ) ) {
+            if ( command.type == CMD_ZOOM ) {
+                producerZoom += command.value;
+            }
+        }
+
+        PROFILE_ZONE( "frame" );
+        producerInput = input.snapshot();
+        producerInputTime = SDL_GetPerformanceCounter();
+        DrawList& list = pipeline.next();
+        {
+            PROFILE_ZONE( "streaming" );
+            world.update( camera );
+            world.takeChanges( worldChanges );
+        }
+        gDrawCalls = 0;
+        gTilesDrawn = 0;
+        {
+            PROFILE_ZONE( "tiles" );
+            submitFrame( world, camera, list, pipeline );
+        }
+        commands += list.size();
+        drawCalls += gDrawCalls;
+        {
+            PROFILE_ZONE( "hud" );
+            snprintf( FPSText, sizeof( FPSText ), "Frame: %d", frame );
+            FPSLabel.setText( FPSText );
+            FPSLabel.render( gRenderer );
+        }
+        {
+            PROFILE_ZONE( "present" );
+            SDL_RenderPresent( gRenderer );
+        }
+        latencyMs.push_back( ( SDL_GetPerformanceCounter() - list.getInputTime() ) * 1000.0 / perfFrequency );
+
+        stepFrame++;
+        if ( stepFrame == s.frames ) {
+            if ( s.key != 0 ) {
+                memset( &e, 0, sizeof( e ) );
+                e.type = SDL_KEYUP;
+                e.key.keysym.sym = s.key;
+                input.handleEvent( e );
+            }
+            step = ( step + 1 ) % stepCount;
+            stepFrame = 0;
+        }
+    }
+    // the last frame ends once the frame it started is produced
+    pipeline.wait();
+    double totalSeconds = ( SDL_GetPerformanceCounter() - benchBegin ) / (double)perfFrequency;
+    frameMs.push_back( ( SDL_GetPerformanceCounter() - frameBegin ) * 1000.0 / perfFrequency );
+
+    if ( frameMs.empty() ) {
+        return 1;
+    }
+    summarize( frameMs, result.frame );
+    summarize( latencyMs, result.latency );
+    result.framesPerSecond = frames / totalSeconds;
+    printf( "bench: %d frames, pipeline: %s, %d entities\n", frames, pipelineModeNames[ mode ], entityCount );
+    printf( "frame time ms: mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+            result.frame.meanMs, result.frame.p50Ms, result.frame.p95Ms, result.frame.p99Ms, result.frame.maxMs );
+    printf( "latency ms: mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+            result.latency.meanMs, result.latency.p50Ms, result.latency.p95Ms, result.latency.p99Ms, result.latency.maxMs );
+    printf( "throughput: %.1f frames/s; per frame: produce ms %.3f, draw commands %.1f, draw calls %.1f\n",
+            result.framesPerSecond, produceMs / frames, (double)commands / frames, (double)drawCalls / frames );
+    return 0;
 }
 
-bool loadMedia()
+int runReplay( ChunkManager& world, TileBatch& tileBatch, HudText& FPSLabel, InputLog& log )
 {
-    gFont = TTF_OpenFont( "lazy.ttf", 28 );
-    if ( gFont == NULL ) {
-        printf( "Failed to load text font! SDL_ttf Error: %s\n", TTF_GetError() );
-        return false;
+    // play a recorded session back headless. Every frame runs the recorded
+    // ticks with the recorded input and interpolates by the recorded amount,
+    // so the camera follows the recorded path at any frame rate. Chunks in
+    // view are finished before a frame is drawn, so a given seed always shows
+    // the same tiles. Prints replay frame times next to the recorded ones,
+    // whether the camera path matched, and a digest of every tile shown
+    Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
+    FrameCache frameCache( SCREEN_WIDTH, SCREEN_HEIGHT );
+    TileEditor editor;
+    TileRenderer renderer = (TileRenderer)( log.header.renderer % RENDER_COUNT );
+    bool incremental = log.header.incremental != 0;
+    const Uint64 perfFrequency = SDL_GetPerformanceFrequency();
+    std::vector<SDL_Rect> worldChanges;
+    std::vector<double> frameMs, recordedMs;
+    int mismatches = 0, firstMismatch = -1;
+    Uint64 digest = 14695981039346656037ull;
+    size_t nextCommand = 0;
+    char FPSText[ 32 ];
+
+    for ( size_t f=0; f<log.frames.size(); f++ ) {
+        const InputLogFrame& frame = log.frames[ f ];
+        InputSnapshot input = { frame.held, frame.mouseX, frame.mouseY };
+        Uint64 frameBegin = SDL_GetPerformanceCounter();
+        PROFILE_ZONE( "frame" );
+        for ( int c=0; c<frame.commandCount && nextCommand<log.commands.size(); c++ ) {
+            const Command& command = log.commands[ nextCommand++ ];
+            if ( command.type == CMD_ZOOM ) {
+                camera.zoomBy( command.value );
+            }
+            else if ( command.type == CMD_CYCLE_RENDERER ) {
+                renderer = (TileRenderer)( ( renderer + 1 ) % RENDER_COUNT );
+                frameCache.invalidate();
+            }
+            else if ( command.type == CMD_TOGGLE_INCREMENTAL ) {
+                incremental = !incremental;
+                frameCache.invalidate();
+            }
+            else if ( command.type == CMD_UNDO ) {
+                editor.undo( world );
+            }
+            else if ( command.type == CMD_REDO ) {
+                editor.redo( world );
+            }
+            else if ( command.type == CMD_BRUSH ) {
+                editor.brushBy( command.value );
+            }
+        }
+        {
+            PROFILE_ZONE( "simulation" );
+            for ( int t=0; t<frame.ticks; t++ ) {
+                camera.applyInput( input );
+                camera.move();
+                editor.update( input, camera, world );
+            }
+            camera.interpolate( frame.alpha );
+            world.update( camera );
+        }
+        // waiting for chunk jobs is not part of the frame time
+        Uint64 waitBegin = SDL_GetPerformanceCounter();
+        while ( world.pendingChunks() > 0 ) {
+            SDL_Delay( 1 );
+            world.update( camera );
+        }
+        frameBegin += SDL_GetPerformanceCounter() - waitBegin;
+        world.takeChanges( worldChanges );
+        for ( size_t i=0; i<worldChanges.size(); i++ ) {
+            frameCache.invalidateWorld( worldChanges[ i ] );
+        }
+
+        {
+            PROFILE_ZONE( "tiles" );
+            bool drawn = incremental && frameCache.render( gRenderer, camera,
+                [&]( Camera& view ) { drawWorld( world, view, tileBatch, renderer ); } );
+            if ( !drawn ) {
+                SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+                SDL_RenderClear( gRenderer );
+                drawWorld( world, camera, tileBatch, renderer );
+            }
+        }
+        {
+            PROFILE_ZONE( "hud" );
+            snprintf( FPSText, sizeof( FPSText ), "Frame: %d", (int)f );
+            FPSLabel.setText( FPSText );
+            FPSLabel.render( gRenderer );
+        }
+        {
+            PROFILE_ZONE( "present" );
+            SDL_RenderPresent( gRenderer );
+        }
+        frameMs.push_back( ( SDL_GetPerformanceCounter() - frameBegin ) * 1000.0 / perfFrequency );
+        recordedMs.push_back( frame.frameMs );
+
+        if ( camera.rect().x != frame.camX || camera.rect().y != frame.camY || (float)camera.getZoom() != frame.zoom ) {
+            mismatches++;
+            if ( firstMismatch < 0 ) {
+                firstMismatch = f;
+            }
+        }
+        Uint64 view = world.viewDigest( camera );
+        for ( int b=0; b<8; b++ ) {
+            digest = ( digest ^ ( ( view >> ( 8*b ) ) & 0xFF ) ) * 1099511628211ull;
+        }
     }
-    return true;
+
+    if ( frameMs.empty() ) {
+        printf( "replay: the log has no frames\n" );
+        return 1;
+    }
+    BenchResult replayed, recorded;
+    summarize( frameMs, replayed );
+    summarize( recordedMs, recorded );
+    printf( "replay: %d frames, seed %u, tile renderer: %s%s\n", (int)log.frames.size(), log.header.seed,
+            tileRendererNames[ log.header.renderer % RENDER_COUNT ], log.header.incremental ? ", incremental" : "" );
+    printf( "%10s %10s %10s %10s %10s %10s\n", "", "mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms" );
+    printf( "%10s %10.3f %10.3f %10.3f %10.3f %10.3f\n", "replayed",
+            replayed.meanMs, replayed.p50Ms, replayed.p95Ms, replayed.p99Ms, replayed.maxMs );
+    printf( "%10s %10.3f %10.3f %10.3f %10.3f %10.3f\n", "recorded",
+            recorded.meanMs, recorded.p50Ms, recorded.p95Ms, recorded.p99Ms, recorded.maxMs );
+    if ( mismatches == 0 ) {
+        printf( "camera path: matches the recording\n" );
+    }
+    else {
+        printf( "camera path: %d frames differ, first at frame %d\n", mismatches, firstMismatch );
+    }
+    printf( "view digest: %016llx\n", (unsigned long long)digest );
+    return mismatches == 0 ? 0 : 1;
 }
 
 int main( int argc, char* argv[] )
 {
-    if ( !init() ) {
+    // --batch or --cached pick the tile renderer, 'b' cycles through them at runtime
+    TileRenderer tileRenderer = RENDER_PER_TILE;
+    // --chunk <n> sets the chunk side length in tiles
+    int chunkLength = FERMI_CHUNK_LENGTH;
+    // --workers <n> and --cache-mb <n> configure chunk streaming
+    int chunkWorkers = std::max( 1, (int)std::thread::hardware_concurrency() - 1 );
+    int chunkCacheMB = 64;
+    // --seed <n> picks the generated terrain
+    Uint32 worldSeed = 1;
+    // --incremental redraws only what changed since the last frame, 'i' toggles it
+    bool incremental = false;
+    // --uncapped or --vsync replace the default 60 FPS cap
+    FramePacing pacing = PACING_CAPPED;
+    // --bench [frames] plays a scripted camera path headless and prints timings
+    bool benchmark = false;
+    int benchFrames = 1200;
+    // --bench-compare runs the benchmark once with every tile renderer
+    bool benchCompare = false;
+    // --world <file> loads chunks from a saved world, F5 and quitting save it
+    const char* worldPath = NULL;
+    // --profile <file> records timing zones and writes a Chrome trace on exit
+    const char* tracePath = NULL;
+    // --record <file> logs the session's input; --replay <file> plays a log back headless
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    // --frame-csv <file> writes the time and counters of every frame
+    const char* frameCsvPath = NULL;
+    // --entities <n> adds n entities moving about the world around the origin
+    int entityCount = 0;
+    // --simulate runs the tile dynamics on every loaded chunk. The chunks that
+    // are loaded depend on timing, so replays of such a session differ. What
+    // it changes in a chunk is neither kept on eviction nor saved, unless the
+    // chunk was also edited
+    bool simulateTiles = false;
+    // --pipeline builds each frame's draw list on its own thread while the last
+    // one is drawn, --pipeline-serial builds and draws it in turn. Both replace
+    // the tile renderer. --bench-pipeline benchmarks the two
+    PipelineMode pipelineMode = PIPELINE_OFF;
+    bool benchPipeline = false;
+    for ( int i=1; i<argc; i++ ) {
+        std::string arg = argv[ i ];
+        if ( arg == "--batch" ) {
+            tileRenderer = RENDER_BATCHED;
+        }
+        else if ( arg == "--cached" ) {
+            tileRenderer = RENDER_CACHED;
+        }
+        else if ( arg == "--chunk" && i+1 < argc ) {
+            chunkLength = std::max( 1, atoi( argv[ ++i ] ) );
+        }
+        else if ( arg == "--workers" && i+1 < argc ) {
+            chunkWorkers = std::max( 1, atoi( argv[ ++i ] ) );
+        }
+        else if ( arg == "--cache-mb" && i+1 < argc ) {
+            chunkCacheMB = std::max( 1, atoi( argv[ ++i ] ) );
+        }
+        else if ( arg == "--seed" && i+1 < argc ) {
+            worldSeed = (Uint32)strtoul( argv[ ++i ], NULL, 0 );
+        }
+        else if ( arg == "--incremental" ) {
+            incremental = true;
+        }
+        else if ( arg == "--uncapped" ) {
+            pacing = PACING_UNCAPPED;
+        }
+        else if ( arg == "--vsync" ) {
+            pacing = PACING_VSYNC;
+        }
+        else if ( arg == "--profile" && i+1 < argc ) {
+            tracePath = argv[ ++i ];
+            profiler::setEnabled( true );
+        }
+        else if ( arg == "--world" && i+1 < argc ) {
+            worldPath = argv[ ++i ];
+        }
+        else if ( arg == "--record" && i+1 < argc ) {
+            recordPath = argv[ ++i ];
+        }
+        else if ( arg == "--replay" && i+1 < argc ) {
+            replayPath = argv[ ++i ];
+        }
+        else if ( arg == "--frame-csv" && i+1 < argc ) {
+            frameCsvPath = argv[ ++i ];
+        }
+        else if ( arg == "--entities" && i+1 < argc ) {
+            entityCount = std::max( 0, atoi( argv[ ++i ] ) );
+        }
+        else if ( arg == "--simulate" ) {
+            simulateTiles = true;
+        }
+        else if ( arg == "--pipeline" ) {
+            pipelineMode = PIPELINE_THREADED;
+        }
+        else if ( arg == "--pipeline-serial" ) {
+            pipelineMode = PIPELINE_SERIAL;
+        }
+        else if ( arg == "--bench-pipeline" ) {
+            benchmark = true;
+            benchPipeline = true;
+        }
+        else if ( arg == "--bench-compare" ) {
+            benchmark = true;
+            benchCompare = true;
+        }
+        else if ( arg == "--bench" ) {
+            benchmark = true;
+            if ( i+1 < argc && atoi( argv[ i+1 ] ) > 0 ) {
+                benchFrames = atoi( argv[ ++i ] );
+            }
+        }
+    }
+
+    // a replay starts the world and renderer the way the recording did
+    InputLog replayLog;
+    if ( replayPath != NULL ) {
+        if ( !replayLog.read( replayPath ) ) {
+            return 3;
+        }
+        worldSeed = replayLog.header.seed;
+        chunkLength = std::max( 1, (int)replayLog.header.chunkLength );
+    }
+    // a recording logs the ticks of each frame with the commands before them,
+    // which the pipeline does not keep apart
+    if ( recordPath != NULL && pipelineMode != PIPELINE_OFF ) {
+        printf( "--record draws without the pipeline\n" );
+        pipelineMode = PIPELINE_OFF;
+    }
+
+    bool headless = benchmark || replayPath != NULL;
+    if ( headless ? !initHeadless() : !init( pacing == PACING_VSYNC ) ) {
         printf( "Error initializing SDL!\n" );
         return 3;
     }
@@ -330,71 +833,392 @@ int main( int argc, char* argv[] )
         return 3;
     }
 
-    gTileTexture = loadTexture( gRenderer, "textures/tilesSpritesheet.png" );
-    std::vector<Tile> chunk;
-    setClips();
-    loadChunk( chunk, 64 );
+    TextureAtlas tileAtlas;
+    if ( !loadTileAtlas( tileAtlas ) ) {
+        printf( "Failed to load the tile atlas!\n" );
+        return 3;
+    }
+    ChunkManager world( chunkLength, chunkWorkers, (size_t)chunkCacheMB * 1024 * 1024, worldSeed );
+    if ( worldPath != NULL && world.openWorld( worldPath ) ) {
+        printf( "Opened world %s\n", worldPath );
+    }
+    TileBatch tileBatch( gTileTexture );
+    // hexagons.png is the last sheet in the atlas and a single sprite
+    const SDL_Rect entityClip = tileAtlas.clip( tileAtlas.spriteCount() - 1 );
 
     Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
 
     SDL_Event e;
 
-    std::stringstream FPSText;
-
+    GlyphAtlas hudAtlas;
+    if ( !hudAtlas.build( gRenderer, gFont ) ) {
+        printf( "Failed to build HUD glyph atlas!\n" );
+    }
+    char FPSText[ 32 ];
     SDL_Color FPStextColor = { 255, 255, 0, 255 };
+    HudText FPSLabel( &hudAtlas, FPStextColor );
+
+    if ( replayPath != NULL ) {
+        int result = runReplay( world, tileBatch, FPSLabel, replayLog );
+        if ( tracePath != NULL ) {
+            profiler::dumpTrace( tracePath );
+        }
+        world.releaseTextures();
+        hudAtlas.release();
+        camera.release();
+        SDL_Quit();
+        return result;
+    }
+
+    if ( benchmark && ( benchPipeline || pipelineMode != PIPELINE_OFF ) ) {
+        int result = 0;
+        PipelineBenchResult results[ PIPELINE_COUNT ];
+        for ( int m=PIPELINE_SERIAL; m<PIPELINE_COUNT; m++ ) {
+            if ( benchPipeline || m == pipelineMode ) {
+                result |= runPipelineBenchmark( world, FPSLabel, (PipelineMode)m, entityCount, worldSeed,
+                                                entityClip, benchFrames, results[ m ] );
+            }
+        }
+        if ( benchPipeline && result == 0 ) {
+            printf( "%10s %10s %10s %10s %12s %12s\n", "pipeline", "frames/s", "mean ms", "p99 ms", "latency ms", "latency p99" );
+            for ( int m=PIPELINE_SERIAL; m<PIPELINE_COUNT; m++ ) {
+                printf( "%10s %10.1f %10.3f %10.3f %12.3f %12.3f\n", pipelineModeNames[ m ], results[ m ].framesPerSecond,
+                        results[ m ].frame.meanMs, results[ m ].frame.p99Ms, results[ m ].latency.meanMs, results[ m ].latency.p99Ms );
+            }
+        }
+        if ( tracePath != NULL ) {
+            profiler::dumpTrace( tracePath );
+        }
+        world.releaseTextures();
+        hudAtlas.release();
+        camera.release();
+        SDL_Quit();
+        return result;
+    }
+
+    if ( benchmark ) {
+        int result = 0;
+        BenchResult results[ RENDER_COUNT ];
+        for ( int r=0; r<RENDER_COUNT; r++ ) {
+            if ( benchCompare || r == tileRenderer ) {
+                result |= runBenchmark( world, tileBatch, FPSLabel, (TileRenderer)r, incremental, benchFrames, results[ r ] );
+            }
+        }
+        if ( benchCompare && result == 0 ) {
+            printf( "%10s %10s %10s %10s %10s %10s\n", "renderer", "mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms" );
+            for ( int r=0; r<RENDER_COUNT; r++ ) {
+                printf( "%10s %10.3f %10.3f %10.3f %10.3f %10.3f\n", tileRendererNames[ r ],
+                        results[ r ].meanMs, results[ r ].p50Ms, results[ r ].p95Ms, results[ r ].p99Ms, results[ r ].maxMs );
+            }
+        }
+        if ( tracePath != NULL ) {
+            profiler::dumpTrace( tracePath );
+        }
+        world.releaseTextures();
+        hudAtlas.release();
+        camera.release();
+        SDL_Quit();
+        return result;
+    }
 
     int frameNumber = 0;
+    // rolling frame times, shown under the FPS with a graph; F3 hides them
+    FrameStats frameStats;
+    FrameWindow frameWindow;
+    if ( frameCsvPath != NULL && frameStats.openCsv( frameCsvPath ) ) {
+        printf( "Writing frame times to %s\n", frameCsvPath );
+    }
+    bool showFrameStats = true;
+    char frameStatsText[ 64 ];
+    HudText frameStatsLabel( &hudAtlas, FPStextColor );
+    frameStatsLabel.setPosition( 0, hudAtlas.lineHeight() );
+    Uint32 labelsUpdated = 0;
+    long chunksBuilt = 0;
 
-    const Uint32 FPSStart = SDL_GetTicks();
+    FrameCache frameCache( SCREEN_WIDTH, SCREEN_HEIGHT );
+    std::vector<SDL_Rect> worldChanges;
+    InputSystem input;
+    // left mouse paints metal and right mouse grass. Ctrl+Z and Ctrl+Y undo and
+    // redo strokes, [ and ] resize the brush
+    TileEditor editor;
+    EntityWorld entities;
+    entities.spawn( entityCount, worldSeed );
+    TileSimulation tileSim( worldSeed );
+    long simTicks = 0;
+    InputLog recordLog;
+    recordLog.header.seed = worldSeed;
+    recordLog.header.chunkLength = chunkLength;
+    recordLog.header.renderer = tileRenderer;
+    recordLog.header.incremental = incremental;
+
+    const Uint64 perfFrequency = SDL_GetPerformanceFrequency();
+    const Uint64 FPSStart = SDL_GetPerformanceCounter();
+    Uint64 lastFrameBegin = FPSStart;
+    double tickAccumulator = 0.0;
+
+    // draw call statistics, printed once per second
+    Uint32 statsStart = SDL_GetTicks();
+    int statsFrames = 0;
+    long statsDrawCalls = 0;
+    double statsLatencyMs = 0.0;
+
+    // advance the simulation in fixed steps, then draw the camera at the
+    // fraction of a tick left over so motion stays smooth at any frame rate.
+    // Returns the number of ticks
+    auto advance = [&]( const InputSnapshot& tickInput, double& alpha ) -> int {
+        int ticks = 0;
+        while ( tickAccumulator >= loop_constants::tickSeconds ) {
+            camera.applyInput( tickInput );
+            camera.move();
+            editor.update( tickInput, camera, world );
+            if ( simulateTiles && simTicks % tilesim_constants::ticksPerStep == 0 ) {
+                world.simulate( tileSim );
+            }
+            simTicks++;
+            entities.tick( &world.workers() );
+            tickAccumulator -= loop_constants::tickSeconds;
+            ticks++;
+        }
+        alpha = tickAccumulator / loop_constants::tickSeconds;
+        camera.interpolate( alpha );
+        return ticks;
+    };
+    // with the pipeline the ticks and culling run in the producer, which owns
+    // the camera, editor, entities and tile simulation until wait() returns.
+    // The frame's input and zoom are handed to it in these
+    InputSnapshot pipelineInput = input.snapshot();
+    Uint64 pipelineInputTime = 0;
+    int pipelineZoom = 0;
+    FramePipeline pipeline( [&]( DrawList& list ) {
+        camera.zoomBy( pipelineZoom );
+        pipelineZoom = 0;
+        {
+            PROFILE_ZONE( "simulation" );
+            double alpha;
+            advance( pipelineInput, alpha );
+        }
+        {
+            PROFILE_ZONE( "cull" );
+            buildDrawList( world, camera, entities, entityClip, list );
+        }
+        list.setInputTime( pipelineInputTime );
+    }, pipelineMode == PIPELINE_THREADED );
+    if ( pipelineMode != PIPELINE_OFF ) {
+        printf( "pipeline: %s, draw lists replace the tile renderer\n", pipelineModeNames[ pipelineMode ] );
+        incremental = false;
+    }
 
     // MAIN LOOP
     bool quit = false;
     while ( !quit ) {
-        int FRAME_BEGIN_MS = SDL_GetTicks();
+        // nothing the producer uses is touched until it is done
+        pipeline.wait();
+        Uint64 frameBegin = SDL_GetPerformanceCounter();
+        double frameSeconds = ( frameBegin - lastFrameBegin ) / (double)perfFrequency;
+        lastFrameBegin = frameBegin;
+        tickAccumulator += std::min( frameSeconds, loop_constants::maxFrameSeconds );
+        // the counters still hold the last frame's values, whose length is only
+        // known now
+        if ( frameNumber > 0 ) {
+            long built = world.stats().generated + world.stats().loaded;
+            frameStats.add( { frameSeconds * 1000.0, gDrawCalls, gTilesDrawn, (int)( built - chunksBuilt ), world.pendingChunks() } );
+            chunksBuilt = built;
+        }
 
-        // handle event queue
-        while ( SDL_PollEvent( &e ) != 0 ) {
-            if ( e.type == SDL_QUIT ) {
-                quit = true;
-            }
+        PROFILE_ZONE( "frame" );
 
-            camera.handleEvent( e );
+        // turn the event queue into input state and commands
+        {
+            PROFILE_ZONE( "events" );
+            while ( SDL_PollEvent( &e ) != 0 ) {
+                input.handleEvent( e );
+            }
+        }
+        Command command;
+        while ( input.pollCommand( command ) ) {
+            if ( recordPath != NULL ) {
+                recordLog.addCommand( command );
+            }
+            switch ( command.type ) {
+                case CMD_QUIT:
+                    quit = true;
+                    break;
+                case CMD_ZOOM:
+                    if ( pipelineMode != PIPELINE_OFF ) {
+                        pipelineZoom += command.value;
+                    }
+                    else {
+                        camera.zoomBy( command.value );
+                    }
+                    break;
+                case CMD_CYCLE_RENDERER:
+                    tileRenderer = (TileRenderer)( ( tileRenderer + 1 ) % RENDER_COUNT );
+                    printf( "tile renderer: %s\n", tileRendererNames[ tileRenderer ] );
+                    frameCache.invalidate();
+                    break;
+                case CMD_TOGGLE_INCREMENTAL:
+                    incremental = !incremental;
+                    printf( "incremental redraw: %s\n", incremental ? "on" : "off" );
+                    frameCache.invalidate();
+                    break;
+                case CMD_SAVE_WORLD:
+                    if ( worldPath != NULL && world.saveWorld( worldPath ) ) {
+                        printf( "Saved world %s\n", worldPath );
+                    }
+                    break;
+                case CMD_TARGETS_RESET:
+                    world.invalidateTextures();
+                    frameCache.invalidate();
+                    break;
+                case CMD_UNDO:
+                    editor.undo( world );
+                    break;
+                case CMD_REDO:
+                    editor.redo( world );
+                    break;
+                case CMD_BRUSH:
+                    editor.brushBy( command.value );
+                    printf( "brush: %d tiles\n", 2 * editor.brushRadius() + 1 );
+                    break;
+                case CMD_TOGGLE_STATS:
+                    showFrameStats = !showFrameStats;
+                    break;
+            }
         }
 
-        // set positions/game state
-        FPSText.str( "" );
-        float FPSTime = frameNumber / ((SDL_GetTicks() - FPSStart) / 1000.0);
-        if ( FPSTime > 2000000 ) {
-            FPSTime = 0;
+        // set positions/game state. The labels change a few times a second so
+        // they stay readable
+        if ( SDL_GetTicks() - labelsUpdated >= 250 ) {
+            frameStats.summarize( frameWindow );
+            snprintf( FPSText, sizeof( FPSText ), "FPS: %.1f", frameWindow.avgMs > 0.0 ? 1000.0 / frameWindow.avgMs : 0.0 );
+            FPSLabel.setText( FPSText );
+            snprintf( frameStatsText, sizeof( frameStatsText ), "ms min %.1f avg %.1f p99 %.1f max %.1f",
+                      frameWindow.minMs, frameWindow.avgMs, frameWindow.p99Ms, frameWindow.maxMs );
+            frameStatsLabel.setText( frameStatsText );
+            labelsUpdated = SDL_GetTicks();
+        }
+        // the per second stats are printed while the producer is idle
+        if ( SDL_GetTicks() - statsStart >= 1000 ) {
+            printf( "tile renderer: %s, draw calls/frame: %.1f, zoom: %.3f\n",
+                    pipelineMode != PIPELINE_OFF ? "draw list" : tileRendererNames[ tileRenderer ],
+                    (double)statsDrawCalls / statsFrames, camera.getZoom() );
+            ChunkCacheStats& cache = world.stats();
+            printf( "chunks: %d loaded (%.1f MB), %d pending, hits: %ld misses: %ld evictions: %ld kept edits: %ld (%.1f KB in memory, %ld spilled)\n",
+                    world.loadedChunks(), world.memoryUsed() / ( 1024.0 * 1024.0 ),
+                    world.pendingChunks(), cache.hits, cache.misses, cache.evictions, cache.keptEdits,
+                    world.keptEditBytes() / 1024.0, cache.spills );
+            if ( simulateTiles ) {
+                TileSimStats& sim = tileSim.stats();
+                printf( "tile simulation: %d chunks, %.2f ms a step, %.2f us a chunk, %ld tiles changed\n",
+                        sim.chunks, sim.ms, sim.chunks > 0 ? sim.ms * 1000.0 / sim.chunks : 0.0, sim.tilesChanged );
+            }
+            if ( pipelineMode != PIPELINE_OFF ) {
+                printf( "pipeline: %s, latency ms: %.2f\n", pipelineModeNames[ pipelineMode ], statsLatencyMs / statsFrames );
+            }
+            statsStart = SDL_GetTicks();
+            statsFrames = 0;
+            statsDrawCalls = 0;
+            statsLatencyMs = 0.0;
         }
-        FPSText << "FPS: " << FPSTime;
-        gFPSTexture = loadTextTexture( FPSText.str().c_str(), FPStextColor );
-        camera.move();
 
-        // clear the renderer
-        SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
-        SDL_RenderClear( gRenderer );
+        int frameTicks = 0;
+        double frameAlpha = 0.0;
+        DrawList* frameList = NULL;
+        {
+            PROFILE_ZONE( "simulation" );
+            if ( pipelineMode != PIPELINE_OFF ) {
+                // threaded, this is the list built during the last frame; the
+                // input read here goes into the one started below
+                pipelineInput = input.snapshot();
+                pipelineInputTime = SDL_GetPerformanceCounter();
+                frameList = &pipeline.next();
+            }
+            else {
+                frameTicks = advance( input.snapshot(), frameAlpha );
+            }
+            world.update( camera );
+            world.takeChanges( worldChanges );
+            for ( size_t i=0; incremental && i<worldChanges.size(); i++ ) {
+                frameCache.invalidateWorld( worldChanges[ i ] );
+            }
+        }
 
-        // draw objects to renderer
-        for ( int i=0; i < 64*64; i++ ) {
-            chunk[ i ].render( camera );
+        // draw objects to renderer. The incremental path copies the last
+        // frame and redraws only what changed; otherwise clear and draw it all
+        gDrawCalls = 0;
+        gTilesDrawn = 0;
+        if ( frameList != NULL ) {
+            PROFILE_ZONE( "tiles" );
+            submitFrame( world, camera, *frameList, pipeline );
+        }
+        else {
+            {
+                PROFILE_ZONE( "tiles" );
+                bool drawn = incremental && frameCache.render( gRenderer, camera,
+                    [&]( Camera& view ) { drawWorld( world, view, tileBatch, tileRenderer ); } );
+                if ( !drawn ) {
+                    SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+                    SDL_RenderClear( gRenderer );
+                    drawWorld( world, camera, tileBatch, tileRenderer );
+                }
+            }
+            // entities move every tick, so they are drawn over the tiles every
+            // frame rather than through the frame cache
+            if ( entities.size() > 0 ) {
+                PROFILE_ZONE( "entities" );
+                SDL_RenderSetScale( gRenderer, camera.getZoom(), camera.getZoom() );
+                entities.render( camera, tileBatch, entityClip );
+                tileBatch.flush( gRenderer );
+                SDL_RenderSetScale( gRenderer, 1.0, 1.0 );
+            }
+        }
+        statsDrawCalls += gDrawCalls;
+        {
+            PROFILE_ZONE( "hud" );
+            FPSLabel.render( gRenderer );
+            if ( showFrameStats ) {
+                frameStatsLabel.render( gRenderer );
+                frameStats.renderGraph( gRenderer, 0, 2 * hudAtlas.lineHeight() );
+            }
         }
-        SDL_SetRenderDrawColor( gRenderer, 0xFF, 0, 0, 0xFF );
-        SDL_RenderDrawRect( gRenderer, &camera.rect() ); // draw cam in red
-        SDL_Rect FPSTextPos = { 0, 0, 200, 50 };
-        SDL_RenderCopy( gRenderer, gFPSTexture, NULL, &FPSTextPos );
 
         // render to screen
-        SDL_RenderPresent( gRenderer );
+        {
+            PROFILE_ZONE( "present" );
+            SDL_RenderPresent( gRenderer );
+        }
         frameNumber++;
+        statsFrames++;
+        if ( frameList != NULL ) {
+            statsLatencyMs += ( SDL_GetPerformanceCounter() - frameList->getInputTime() ) * 1000.0 / perfFrequency;
+        }
+        if ( recordPath != NULL ) {
+            double frameMs = ( SDL_GetPerformanceCounter() - frameBegin ) * 1000.0 / perfFrequency;
+            recordLog.addFrame( input.snapshot(), frameTicks, frameAlpha, camera.rect(), camera.getZoom(), frameMs );
+        }
 
-        int FRAME_END_MS = SDL_GetTicks();
-        int FRAME_ELAPSED_TIME = FRAME_END_MS - FRAME_BEGIN_MS;
-        if ( FRAME_ELAPSED_TIME < 1000.0/60.0 ) {
-            SDL_Delay( 1000.0/60.0 - FRAME_ELAPSED_TIME );
+        if ( pacing == PACING_CAPPED ) {
+            double frameElapsed = ( SDL_GetPerformanceCounter() - frameBegin ) / (double)perfFrequency;
+            if ( frameElapsed < loop_constants::tickSeconds ) {
+                SDL_Delay( ( loop_constants::tickSeconds - frameElapsed ) * 1000.0 );
+            }
         }
     }
+    pipeline.wait();
 
+    if ( tracePath != NULL ) {
+        profiler::dumpTrace( tracePath );
+    }
+    if ( worldPath != NULL && world.saveWorld( worldPath ) ) {
+        printf( "Saved world %s\n", worldPath );
+    }
+    if ( recordPath != NULL && recordLog.write( recordPath ) ) {
+        printf( "Recorded %d frames to %s\n", (int)recordLog.frames.size(), recordPath );
+    }
+    world.releaseTextures();
+    frameCache.release();
+    hudAtlas.release();
+    camera.release();
     SDL_Quit();
     printf( "SDL quit successfully.\n" );
     return 0;
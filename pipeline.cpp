@@ -0,0 +1,76 @@
+#include "pipeline.h"
+#include "profiler.h"
+
+FramePipeline::FramePipeline( FrameProducer produce, bool threaded )
+{
+    this->produce = produce;
+    this->threaded = threaded;
+    this->front = 0;
+    this->produced = false;
+    this->requested = false;
+    this->stopping = false;
+    if ( threaded ) {
+        this->producer = std::thread( &FramePipeline::producerLoop, this );
+    }
+}
+FramePipeline::~FramePipeline()
+{
+    if ( this->producer.joinable() ) {
+        {
+            std::lock_guard<std::mutex> lock( this->mutex );
+            this->stopping = true;
+        }
+        this->wake.notify_one();
+        this->producer.join();
+    }
+}
+void FramePipeline::wait()
+{
+    std::unique_lock<std::mutex> lock( this->mutex );
+    this->idle.wait( lock, [this] { return !this->requested; } );
+}
+DrawList& FramePipeline::next()
+{
+    // the first threaded frame has nothing produced yet, so it is produced
+    // here like a serial one
+    if ( this->threaded && this->produced ) {
+        this->front = 1 - this->front;
+        this->produced = false;
+    }
+    else {
+        this->produce( this->lists[ this->front ] );
+    }
+    return this->lists[ this->front ];
+}
+void FramePipeline::start()
+{
+    if ( !this->threaded ) {
+        return;
+    }
+    this->produced = true;
+    {
+        std::lock_guard<std::mutex> lock( this->mutex );
+        this->requested = true;
+    }
+    this->wake.notify_one();
+}
+void FramePipeline::producerLoop()
+{
+    std::unique_lock<std::mutex> lock( this->mutex );
+    while ( true ) {
+        this->wake.wait( lock, [this] { return this->requested || this->stopping; } );
+        if ( this->stopping ) {
+            return;
+        }
+        // front does not change while a list is requested
+        DrawList& back = this->lists[ 1 - this->front ];
+        lock.unlock();
+        {
+            PROFILE_ZONE( "produce" );
+            this->produce( back );
+        }
+        lock.lock();
+        this->requested = false;
+        this->idle.notify_all();
+    }
+}
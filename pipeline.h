@@ -0,0 +1,60 @@
+#ifndef FERMI_PIPELINE_H
+#define FERMI_PIPELINE_H
+
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+#include "drawlist.h"
+
+// fills a list with everything of one frame up to drawing: simulation ticks
+// and culling. It must not call the renderer
+typedef std::function<void( DrawList& list )> FrameProducer;
+
+// Two draw lists, one being drawn while the next frame is produced into the
+// other. Threaded, the producer runs on its own thread: start() has it build
+// the next list while the render thread submits the one next() returned, so
+// frame N+1 is simulated and culled while frame N is drawn, at the cost of one
+// frame of latency. Serial, next() produces the list on the calling thread
+// and start() does nothing, so both modes run the same code in the same order.
+//
+// The state the producer uses belongs to it from start() until wait()
+// returns; in between the caller may not touch it, and next() may only be
+// called after wait(). A frame goes:
+//     wait();                 // the producer is idle
+//     ...                     // commands, streaming, anything on shared state
+//     DrawList& list = next();
+//     ...                     // what only the render thread can draw
+//     start();
+//     list.submit( renderer );
+class FramePipeline {
+public:
+    FramePipeline( FrameProducer produce, bool threaded );
+    ~FramePipeline();
+    void wait();
+    DrawList& next();
+    void start();
+
+    bool isThreaded() { return this->threaded; };
+private:
+    void producerLoop();
+
+    FrameProducer produce;
+    bool threaded;
+    DrawList lists[ 2 ];
+    // the list next() returned last; the producer fills the other one
+    int front;
+    // a list was started into the back that next() has not returned yet.
+    // Only used by the caller's thread
+    bool produced;
+    // guarded by mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool requested;
+    bool stopping;
+    std::thread producer;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include <stdio.h>
+
+#include "profiler.h"
+
+namespace {
+    struct ProfileEvent {
+        // index + 1 of the zone stored in this slot, 0 while it is being written
+        std::atomic<Uint64> sequence;
+        std::atomic<const char*> name;
+        std::atomic<Uint64> start;
+        std::atomic<Uint64> end;
+        std::atomic<int> thread;
+    };
+
+    ProfileEvent events[ profiler_constants::capacity ];
+    std::atomic<Uint64> head( 0 );
+    std::atomic<int> threadCount( 0 );
+    // trace timestamps are relative to the moment the profiler was enabled
+    std::atomic<Uint64> origin( 0 );
+
+    int threadIndex()
+    {
+        // small stable ids for the trace viewer, in order of first use
+        static thread_local int index = threadCount.fetch_add( 1 );
+        return index;
+    }
+};
+
+std::atomic<bool> profiler::active( false );
+
+void profiler::setEnabled( bool enabled )
+{
+    if ( enabled && !active.load( std::memory_order_relaxed ) ) {
+        origin.store( SDL_GetPerformanceCounter(), std::memory_order_relaxed );
+    }
+    active.store( enabled, std::memory_order_relaxed );
+}
+
+void profiler::record( const char* name, Uint64 start, Uint64 end )
+{
+    // claim the next slot; when the buffer wraps the oldest zone is overwritten
+    Uint64 index = head.fetch_add( 1, std::memory_order_relaxed );
+    ProfileEvent& e = events[ index & ( profiler_constants::capacity - 1 ) ];
+    e.sequence.store( 0, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    e.name.store( name, std::memory_order_relaxed );
+    e.start.store( start, std::memory_order_relaxed );
+    e.end.store( end, std::memory_order_relaxed );
+    e.thread.store( threadIndex(), std::memory_order_relaxed );
+    e.sequence.store( index + 1, std::memory_order_release );
+}
+
+bool profiler::dumpTrace( const char* path )
+{
+    // write every complete zone still in the buffer. Slots that are being
+    // written or were overwritten while dumping are skipped
+    FILE* f = fopen( path, "w" );
+    if ( f == NULL ) {
+        printf( "Unable to open trace file %s!\n", path );
+        return false;
+    }
+    const double usPerTick = 1e6 / SDL_GetPerformanceFrequency();
+    Uint64 last = head.load( std::memory_order_acquire );
+    Uint64 first = last > profiler_constants::capacity ? last - profiler_constants::capacity : 0;
+    Uint64 start0 = origin.load( std::memory_order_relaxed );
+    int written = 0;
+    fprintf( f, "{\"traceEvents\":[\n" );
+    for ( Uint64 i=first; i<last; i++ ) {
+        ProfileEvent& e = events[ i & ( profiler_constants::capacity - 1 ) ];
+        if ( e.sequence.load( std::memory_order_acquire ) != i + 1 ) {
+            continue;
+        }
+        const char* name = e.name.load( std::memory_order_relaxed );
+        Uint64 start = e.start.load( std::memory_order_relaxed );
+        Uint64 end = e.end.load( std::memory_order_relaxed );
+        int thread = e.thread.load( std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if ( e.sequence.load( std::memory_order_relaxed ) != i + 1 ) {
+            continue;
+        }
+        fprintf( f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                 written > 0 ? ",\n" : "", name, thread,
+                 ( (double)start - (double)start0 ) * usPerTick, ( end - start ) * usPerTick );
+        written++;
+    }
+    fprintf( f, "\n]}\n" );
+    fclose( f );
+    printf( "Wrote %d profile zones to %s\n", written, path );
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef FERMI_PROFILER_H
+#define FERMI_PROFILER_H
+
+#include <atomic>
+
+#include <SDL2/SDL.h>
+
+// Scoped timing zones recorded into a fixed size ring buffer that any thread
+// can write to without locking. When the profiler is disabled a zone costs one
+// relaxed atomic load; building with -DFERMI_NO_PROFILER removes zones entirely.
+// Captures are written as Chrome trace-event JSON (chrome://tracing, Perfetto).
+
+namespace profiler_constants {
+    // number of zones kept; older zones are overwritten. Must be a power of two
+    const unsigned int capacity = 1 << 16;
+};
+
+namespace profiler {
+    extern std::atomic<bool> active;
+
+    void setEnabled( bool enabled );
+    inline bool enabled() { return active.load( std::memory_order_relaxed ); };
+    void record( const char* name, Uint64 start, Uint64 end );
+    bool dumpTrace( const char* path );
+};
+
+class ProfileZone {
+public:
+    ProfileZone( const char* name )
+    {
+        this->name = profiler::enabled() ? name : NULL;
+        this->start = 0;
+        if ( this->name != NULL ) {
+            this->start = SDL_GetPerformanceCounter();
+        }
+    };
+    ~ProfileZone()
+    {
+        if ( this->name != NULL ) {
+            profiler::record( this->name, this->start, SDL_GetPerformanceCounter() );
+        }
+    };
+private:
+    const char* name;
+    Uint64 start;
+};
+
+#define PROFILE_CONCAT_( a, b ) a##b
+#define PROFILE_CONCAT( a, b ) PROFILE_CONCAT_( a, b )
+#ifdef FERMI_NO_PROFILER
+#define PROFILE_ZONE( name )
+#else
+// times the rest of the enclosing scope; name must be a string literal
+#define PROFILE_ZONE( name ) ProfileZone PROFILE_CONCAT( profileZone, __LINE__ )( name )
+#endif
+
+#endif
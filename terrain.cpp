@@ -0,0 +1,143 @@
+#include <string.h>
+
+#include "terrain.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
+namespace {
+    inline Uint32 latticeHash( Uint32 seed, int x, int y )
+    {
+        // 8 bit value for a lattice point
+        Uint32 h = (Uint32)x * 0x8DA6B343u ^ (Uint32)y * 0xD8163841u ^ seed;
+        h ^= h >> 13;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 16;
+        return h >> 24;
+    }
+
+    inline int valueNoise( Uint32 seed, int x, int y, int shift )
+    {
+        // bilinear blend of the four lattice values around x, y in fixed point:
+        // the weights are in [0, 1 << shift] and the result in [0, 255 * 256]
+        int cx = x >> shift, cy = y >> shift;
+        int fx = ( x & ( ( 1 << shift ) - 1 ) ) << ( 4 - shift );
+        int fy = ( y & ( ( 1 << shift ) - 1 ) ) << ( 4 - shift );
+        int h00 = latticeHash( seed, cx, cy );
+        int h10 = latticeHash( seed, cx + 1, cy );
+        int h01 = latticeHash( seed, cx, cy + 1 );
+        int h11 = latticeHash( seed, cx + 1, cy + 1 );
+        return h00 * ( 16 - fx ) * ( 16 - fy ) + h10 * fx * ( 16 - fy )
+             + h01 * ( 16 - fx ) * fy + h11 * fx * fy;
+    }
+
+#ifdef __SSE2__
+    inline __m128i mullo32( __m128i a, __m128i b )
+    {
+#ifdef __SSE4_1__
+        return _mm_mullo_epi32( a, b );
+#else
+        // SSE2 has no 32 bit low multiply; multiply even and odd lanes as 64 bit
+        __m128i even = _mm_mul_epu32( a, b );
+        __m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+        return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+                                   _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+#endif
+    }
+
+    inline __m128i finishHash4( __m128i h )
+    {
+        // latticeHash() after the coordinates are mixed in
+        h = _mm_xor_si128( h, _mm_srli_epi32( h, 13 ) );
+        h = mullo32( h, _mm_set1_epi32( (int)0x85EBCA6Bu ) );
+        h = _mm_xor_si128( h, _mm_srli_epi32( h, 16 ) );
+        return _mm_srli_epi32( h, 24 );
+    }
+
+    inline __m128i valueNoise4( Uint32 seed, __m128i x, int y, int shift )
+    {
+        // four lanes of valueNoise() along one row. The row terms of the hash
+        // are scalars and the next lattice column only adds a constant, which
+        // leaves one vector multiply per lattice point. Every product in the
+        // blend fits in 16 bits, so the 16 bit multiply gives exact results
+        const __m128i kx = _mm_set1_epi32( (int)0x8DA6B343u );
+        const __m128i mask = _mm_set1_epi32( ( 1 << shift ) - 1 );
+        const __m128i sixteen = _mm_set1_epi32( 16 );
+        int cy = y >> shift;
+        int fy = ( y & ( ( 1 << shift ) - 1 ) ) << ( 4 - shift );
+        __m128i row0 = _mm_set1_epi32( (int)( (Uint32)cy * 0xD8163841u ^ seed ) );
+        __m128i row1 = _mm_set1_epi32( (int)( (Uint32)( cy + 1 ) * 0xD8163841u ^ seed ) );
+        __m128i col0 = mullo32( _mm_srai_epi32( x, shift ), kx );
+        __m128i col1 = _mm_add_epi32( col0, kx );
+        __m128i fx = _mm_slli_epi32( _mm_and_si128( x, mask ), 4 - shift );
+        __m128i gx = _mm_sub_epi32( sixteen, fx );
+        __m128i wy0 = _mm_set1_epi32( 16 - fy );
+        __m128i wy1 = _mm_set1_epi32( fy );
+        __m128i h00 = finishHash4( _mm_xor_si128( col0, row0 ) );
+        __m128i h10 = finishHash4( _mm_xor_si128( col1, row0 ) );
+        __m128i h01 = finishHash4( _mm_xor_si128( col0, row1 ) );
+        __m128i h11 = finishHash4( _mm_xor_si128( col1, row1 ) );
+        __m128i v = _mm_mullo_epi16( h00, _mm_mullo_epi16( gx, wy0 ) );
+        v = _mm_add_epi32( v, _mm_mullo_epi16( h10, _mm_mullo_epi16( fx, wy0 ) ) );
+        v = _mm_add_epi32( v, _mm_mullo_epi16( h01, _mm_mullo_epi16( gx, wy1 ) ) );
+        v = _mm_add_epi32( v, _mm_mullo_epi16( h11, _mm_mullo_epi16( fx, wy1 ) ) );
+        return v;
+    }
+#endif
+};
+
+TerrainGenerator::TerrainGenerator( Uint32 seed )
+{
+    this->seed = seed;
+}
+Uint8 TerrainGenerator::tileAt( int tileX, int tileY ) const
+{
+    // the fine octave uses its own lattice so it does not line up with the coarse one
+    int v = 2 * valueNoise( this->seed, tileX, tileY, terrain_constants::coarseShift )
+              + valueNoise( this->seed ^ 0x9E3779B9u, tileX, tileY, terrain_constants::fineShift );
+    return v > terrain_constants::metalThreshold ? TILE_METAL : TILE_GRASS;
+}
+void TerrainGenerator::generateScalar( Chunk& chunk, int tileX0, int tileY0 ) const
+{
+    // reference implementation, one tile at a time
+    for ( int i=0; i<chunk.length(); i++ ) {
+        for ( int j=0; j<chunk.length(); j++ ) {
+            chunk.setType( i, j, this->tileAt( tileX0 + j, tileY0 + i ) );
+        }
+    }
+}
+void TerrainGenerator::generate( Chunk& chunk, int tileX0, int tileY0 ) const
+{
+    // fill a whole chunk whose top left tile is at tileX0, tileY0
+#ifdef __SSE2__
+    const int len = chunk.length();
+    const Uint32 fineSeed = this->seed ^ 0x9E3779B9u;
+    const __m128i threshold = _mm_set1_epi32( terrain_constants::metalThreshold );
+    const __m128i lane = _mm_set_epi32( 3, 2, 1, 0 );
+    for ( int i=0; i<len; i++ ) {
+        Uint8* row = chunk.data() + i * len;
+        int y = tileY0 + i;
+        int j = 0;
+        for ( ; j+4<=len; j+=4 ) {
+            __m128i x = _mm_add_epi32( _mm_set1_epi32( tileX0 + j ), lane );
+            __m128i v = _mm_add_epi32( _mm_slli_epi32( valueNoise4( this->seed, x, y, terrain_constants::coarseShift ), 1 ),
+                                       valueNoise4( fineSeed, x, y, terrain_constants::fineShift ) );
+            // TILE_METAL or TILE_GRASS per lane, packed down to 4 bytes
+            __m128i metal = _mm_srli_epi32( _mm_cmpgt_epi32( v, threshold ), 31 );
+            metal = _mm_packs_epi32( metal, metal );
+            metal = _mm_packus_epi16( metal, metal );
+            int packed = _mm_cvtsi128_si32( metal );
+            memcpy( row + j, &packed, 4 );
+        }
+        for ( ; j<len; j++ ) {
+            row[ j ] = this->tileAt( tileX0 + j, tileY0 + i );
+        }
+    }
+#else
+    this->generateScalar( chunk, tileX0, tileY0 );
+#endif
+}
@@ -0,0 +1,35 @@
+#ifndef FERMI_TERRAIN_H
+#define FERMI_TERRAIN_H
+
+#include "common.h"
+#include "tile.h"
+
+// the SIMD kernel writes its compare results straight into the chunk
+static_assert( TILE_GRASS == 0 && TILE_METAL == 1, "terrain kernel assumes grass 0, metal 1" );
+
+namespace terrain_constants {
+    // two octaves of value noise; cell sizes are powers of two in tiles
+    const int coarseShift = 4;
+    const int fineShift = 2;
+    // tiles whose noise value is above this become metal. Values range over
+    // [0, 3 * 255 * 256], the coarse octave counting twice
+    const int metalThreshold = 120000;
+};
+
+// Seeded, counter based terrain: the type of a tile is a pure function of the
+// seed and its world tile coordinates, so chunks can be generated on any thread
+// and in any order. Uses integer arithmetic only, so the SIMD kernel and the
+// scalar reference produce identical chunks
+class TerrainGenerator {
+public:
+    TerrainGenerator( Uint32 seed );
+    Uint8 tileAt( int tileX, int tileY ) const;
+    void generate( Chunk& chunk, int tileX0, int tileY0 ) const;
+    void generateScalar( Chunk& chunk, int tileX0, int tileY0 ) const;
+
+    Uint32 getSeed() const { return this->seed; };
+private:
+    Uint32 seed;
+};
+
+#endif
@@ -0,0 +1,551 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <SDL2/SDL.h>
+
+#include "common.h"
+#include "tile.h"
+#include "terrain.h"
+#include "worldfile.h"
+#include "world.h"
+#include "inputlog.h"
+#include "editor.h"
+#include "entities.h"
+#include "pipeline.h"
+#include "tilesim.h"
+
+// globals the engine expects from its front-end. Nothing here draws, so the
+// renderer and textures stay NULL
+SDL_Rect gTileClips[ TILE_COUNT ];
+Uint32 gTileColors[ TILE_COUNT ];
+SDL_Renderer* gRenderer = NULL;
+SDL_Texture* gTileTexture = NULL;
+int gDrawCalls = 0;
+int gTilesDrawn = 0;
+
+bool check( bool condition, const char* what )
+{
+    if ( !condition ) {
+        printf( "    FAILED: %s\n", what );
+    }
+    return condition;
+}
+
+void loadView( ChunkManager& world, Camera& camera )
+{
+    // every chunk in view built, so digests of the view only change with tiles
+    world.update( camera );
+    while ( world.pendingChunks() > 0 ) {
+        SDL_Delay( 1 );
+        world.update( camera );
+    }
+}
+
+bool testCore()
+{
+    // the C interface builds the same chunks as the engine, and the visible
+    // range of a chunk holds exactly the tiles whose rects overlap the view
+    bool ok = true;
+    const int length = 16;
+    Chunk chunk( length, -100, 50 );
+    std::vector<Uint8> types( length * length );
+    TerrainGenerator( 99 ).generate( chunk, -40, 17 );
+    fermiGenerateChunk( 99, -40, 17, length, types.data() );
+    ok = check( memcmp( chunk.data(), types.data(), types.size() ) == 0, "C interface chunk matches the engine" ) && ok;
+    std::minstd_rand rng( 5 );
+    for ( int v=0; v<1000; v++ ) {
+        SDL_Rect view = { (int)( rng() % 1200 ) - 700, (int)( rng() % 1200 ) - 500, (int)( rng() % 800 ) + 1, (int)( rng() % 800 ) + 1 };
+        int row0, row1, col0, col1;
+        bool visible = chunk.visibleRange( view, row0, row1, col0, col1 );
+        bool same = true;
+        for ( int i=0; i<length; i++ ) {
+            for ( int j=0; j<length; j++ ) {
+                bool inRange = visible && i >= row0 && i < row1 && j >= col0 && j < col1;
+                same = same && inRange == checkCollision( chunk.tileRect( i, j ), view );
+            }
+        }
+        ok = check( same, "visible range matches the overlapping tiles" ) && ok;
+    }
+    return ok;
+}
+
+bool testChunkRecords()
+{
+    // every pattern encodes and decodes back to the same tiles, raw when run
+    // lengths do not pay off, and damaged records are rejected
+    bool ok = true;
+    const int lengths[] = { 1, 2, 7, 16, 64, 255 };
+    std::minstd_rand rng( 1 );
+    for ( size_t l=0; l<sizeof( lengths ) / sizeof( lengths[ 0 ] ); l++ ) {
+        int length = lengths[ l ];
+        size_t tiles = (size_t)length * length;
+        for ( int pattern=0; pattern<4; pattern++ ) {
+            std::vector<Uint8> types( tiles );
+            for ( size_t i=0; i<tiles; i++ ) {
+                switch ( pattern ) {
+                    case 0: types[ i ] = TILE_GRASS; break;
+                    case 1: types[ i ] = ( i / length + i % length ) % 2; break;
+                    case 2: types[ i ] = rng() % 2; break;
+                    default: types[ i ] = ( i / 300 ) % 2; break;
+                }
+            }
+            std::vector<Uint8> record;
+            Uint32 encoding = encodeChunkRecord( types.data(), length, record );
+            std::vector<Uint8> decoded( tiles, 0xFF );
+            ok = check( decodeChunkRecord( record.data(), record.size(), encoding, decoded.data(), length ),
+                        "record decodes" ) && ok;
+            ok = check( decoded == types, "decoded tiles match" ) && ok;
+            ok = check( record.size() <= tiles, "record no larger than raw tiles" ) && ok;
+            if ( encoding == worldfile_constants::encodingRle && record.size() >= 2 ) {
+                ok = check( !decodeChunkRecord( record.data(), record.size() - 2, encoding, decoded.data(), length ),
+                            "truncated run-length record is rejected" ) && ok;
+            }
+            else {
+                ok = check( !decodeChunkRecord( record.data(), record.size() - 1, encoding, decoded.data(), length ),
+                            "short raw record is rejected" ) && ok;
+            }
+        }
+    }
+    return ok;
+}
+
+bool writeBytes( const char* path, const std::vector<char>& bytes )
+{
+    std::ofstream out( path, std::ios::binary | std::ios::trunc );
+    out.write( bytes.data(), bytes.size() );
+    return out.good();
+}
+
+bool testWorldFile()
+{
+    // chunks written with WorldFileWriter are read back from the mapped file,
+    // damaged headers and indexes are refused, and a world saved by the chunk
+    // manager (written next to the file and renamed over it) opens with the
+    // same tiles
+    bool ok = true;
+    const int length = 16;
+    const char* path = "tests_world.tmp";
+    std::vector<Chunk> chunks;
+    WorldFileWriter writer( length );
+    for ( int cy=-1; cy<=1; cy++ ) {
+        for ( int cx=-1; cx<=1; cx++ ) {
+            chunks.push_back( Chunk( length, cx * length * TILE_W, cy * length * TILE_H ) );
+            if ( ( cx + cy ) % 2 == 0 ) {
+                loadChunk( chunks.back(), ( cy + 1 ) * 3 + cx + 1 );
+            }
+            writer.add( { cx, cy }, chunks.back().data() );
+        }
+    }
+    ok = check( writer.write( path ), "world file is written" ) && ok;
+    {
+        WorldFile file;
+        ok = check( file.open( path ) && file.chunkLength() == length && file.chunkCount() == 9,
+                    "world file opens with its header" ) && ok;
+        Chunk chunk( length );
+        for ( int i=0; i<9; i++ ) {
+            ok = check( file.readChunk( { i % 3 - 1, i / 3 - 1 }, chunk ) &&
+                        memcmp( chunk.data(), chunks[ i ].data(), length * length ) == 0, "chunks read back" ) && ok;
+        }
+        ok = check( !file.readChunk( { 2, 0 }, chunk ), "missing chunk is not found" ) && ok;
+        Chunk other( length + 1 );
+        ok = check( !file.readChunk( { 0, 0 }, other ), "chunk of another length is refused" ) && ok;
+    }
+
+    std::ifstream in( path, std::ios::binary );
+    std::vector<char> bytes( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+    in.close();
+    WorldFileHeader* header = (WorldFileHeader*)bytes.data();
+    WorldFileIndexEntry* index = (WorldFileIndexEntry*)( bytes.data() + sizeof( WorldFileHeader ) );
+    ok = check( header->chunkCount == 9 && index[ 4 ].x == 0 && index[ 4 ].y == 0, "index is sorted by rows" ) && ok;
+    const char* damaged = "tests_damaged.tmp";
+    WorldFile file;
+    Chunk chunk( length );
+    // cut inside the header
+    std::vector<char> cut( bytes.begin(), bytes.begin() + sizeof( WorldFileHeader ) - 1 );
+    ok = check( writeBytes( damaged, cut ) && !file.open( damaged ), "truncated header is refused" ) && ok;
+    std::vector<char> copy( bytes );
+    ( (WorldFileHeader*)copy.data() )->magic ^= 1;
+    ok = check( writeBytes( damaged, copy ) && !file.open( damaged ), "wrong magic is refused" ) && ok;
+    copy = bytes;
+    ( (WorldFileHeader*)copy.data() )->version++;
+    ok = check( writeBytes( damaged, copy ) && !file.open( damaged ), "wrong version is refused" ) && ok;
+    copy = bytes;
+    ( (WorldFileHeader*)copy.data() )->chunkCount = 1 << 24;
+    ok = check( writeBytes( damaged, copy ) && !file.open( damaged ), "index past the end is refused" ) && ok;
+    copy = bytes;
+    ( (WorldFileHeader*)copy.data() )->chunkLength = 0;
+    ok = check( writeBytes( damaged, copy ) && !file.open( damaged ), "zero chunk length is refused" ) && ok;
+    // a record pointing past the end of the file opens, but that chunk is not read
+    copy = bytes;
+    ( (WorldFileIndexEntry*)( copy.data() + sizeof( WorldFileHeader ) ) )[ 4 ].offset = bytes.size();
+    ok = check( writeBytes( damaged, copy ) && file.open( damaged ) && !file.readChunk( { 0, 0 }, chunk ) &&
+                file.readChunk( { -1, -1 }, chunk ), "record past the end is refused" ) && ok;
+    file.close();
+    remove( damaged );
+
+    // an edit saved over the file, then opened by a new manager
+    {
+        ChunkManager world( length, 1, 64 * 1024 * 1024, 11 );
+        ok = check( world.openWorld( path ), "manager opens the world file" ) && ok;
+        Uint8 before;
+        world.setTile( 3, -20, TILE_METAL, &before );
+        world.setTile( 40, 40, TILE_METAL );
+        world.setTile( 41, 40, TILE_GRASS );
+        ok = check( world.saveWorld( path ), "manager saves the world file" ) && ok;
+    }
+    {
+        WorldFile saved;
+        ok = check( saved.open( path ) && saved.chunkCount() == 11, "saved file holds the old and the edited chunks" ) && ok;
+        ok = check( saved.readChunk( { 0, -2 }, chunk ) && chunk.getType( 12, 3 ) == TILE_METAL, "edit of a generated chunk is saved" ) && ok;
+        ok = check( saved.readChunk( { 2, 2 }, chunk ) && chunk.getType( 8, 8 ) == TILE_METAL && chunk.getType( 8, 9 ) == TILE_GRASS,
+                    "edits are saved" ) && ok;
+        ok = check( saved.readChunk( { 1, 1 }, chunk ) && memcmp( chunk.data(), chunks[ 8 ].data(), length * length ) == 0,
+                    "chunks that were not loaded are kept" ) && ok;
+    }
+    remove( path );
+    return ok;
+}
+
+bool testTerrain()
+{
+    // the same seed gives the same chunks from separate generators, in any
+    // order and at any offset; the SIMD kernel matches the scalar reference,
+    // also for lengths with a scalar tail; another seed gives other chunks
+    bool ok = true;
+    const int lengths[] = { 1, 15, 16, 33, 64 };
+    TerrainGenerator terrain( 2024 );
+    TerrainGenerator again( 2024 );
+    TerrainGenerator other( 2025 );
+    for ( size_t l=0; l<sizeof( lengths ) / sizeof( lengths[ 0 ] ); l++ ) {
+        int length = lengths[ l ];
+        size_t tiles = (size_t)length * length;
+        for ( int k=-2; k<=2; k++ ) {
+            int tileX = k * 37 - 5, tileY = -k * 53 + 3;
+            Chunk simd( length ), scalar( length ), repeat( length );
+            terrain.generate( simd, tileX, tileY );
+            terrain.generateScalar( scalar, tileX, tileY );
+            again.generate( repeat, tileX, tileY );
+            ok = check( memcmp( simd.data(), scalar.data(), tiles ) == 0, "SIMD kernel matches the scalar one" ) && ok;
+            ok = check( memcmp( simd.data(), repeat.data(), tiles ) == 0, "same seed gives the same chunk" ) && ok;
+            bool tileAt = true;
+            for ( int i=0; i<length; i++ ) {
+                for ( int j=0; j<length; j++ ) {
+                    tileAt = tileAt && simd.getType( i, j ) == terrain.tileAt( tileX + j, tileY + i );
+                }
+            }
+            ok = check( tileAt, "chunk matches tileAt" ) && ok;
+        }
+    }
+    // a big chunk has both tile types, and the other seed changes many of them
+    Chunk first( 64 ), second( 64 );
+    terrain.generate( first, 0, 0 );
+    other.generate( second, 0, 0 );
+    long metal = std::count( first.data(), first.data() + 64 * 64, (Uint8)TILE_METAL );
+    long differ = 0;
+    for ( int i=0; i<64*64; i++ ) {
+        differ += first.data()[ i ] != second.data()[ i ];
+    }
+    ok = check( metal > 0 && metal < 64 * 64, "terrain has both tile types" ) && ok;
+    ok = check( differ > 64, "another seed gives another chunk" ) && ok;
+    return ok;
+}
+
+bool testInputLog()
+{
+    // a log written and read back holds the same header, frames and commands;
+    // a file that is not a log is refused
+    bool ok = true;
+    const char* path = "tests_log.tmp";
+    InputLog log;
+    log.header.seed = 42;
+    log.header.chunkLength = 64;
+    log.header.renderer = 2;
+    log.header.incremental = 1;
+    for ( int f=0; f<100; f++ ) {
+        for ( int c=0; c<f%3; c++ ) {
+            Command command = { (Uint32)( c == 0 ? CMD_ZOOM : CMD_UNDO ), f - 50 };
+            log.addCommand( command );
+        }
+        InputSnapshot input = { (Uint32)( f % 64 ), f * 3, -f };
+        SDL_Rect view = { f * 8, -f * 4, SCREEN_WIDTH, SCREEN_HEIGHT };
+        log.addFrame( input, f % 4, f / 100.0, view, 1.0 - f / 200.0, 16.0 + f );
+    }
+    ok = check( log.write( path ), "log is written" ) && ok;
+    InputLog back;
+    ok = check( back.read( path ), "log is read" ) && ok;
+    ok = check( back.header.seed == 42 && back.header.chunkLength == 64 && back.header.renderer == 2 &&
+                back.header.incremental == 1, "header matches" ) && ok;
+    ok = check( back.frames.size() == log.frames.size() && back.commands.size() == log.commands.size(),
+                "frame and command counts match" ) && ok;
+    for ( size_t f=0; ok && f<log.frames.size(); f++ ) {
+        const InputLogFrame& a = log.frames[ f ];
+        const InputLogFrame& b = back.frames[ f ];
+        ok = check( a.held == b.held && a.mouseX == b.mouseX && a.mouseY == b.mouseY && a.camX == b.camX &&
+                    a.camY == b.camY && a.zoom == b.zoom && a.alpha == b.alpha && a.frameMs == b.frameMs &&
+                    a.ticks == b.ticks && a.commandCount == b.commandCount, "frames match" );
+    }
+    for ( size_t c=0; ok && c<log.commands.size(); c++ ) {
+        ok = check( log.commands[ c ].type == back.commands[ c ].type && log.commands[ c ].value == back.commands[ c ].value,
+                    "commands match" );
+    }
+    FILE* f = fopen( path, "wb" );
+    if ( f != NULL ) {
+        fputs( "not an input log", f );
+        fclose( f );
+    }
+    InputLog bad;
+    ok = check( !bad.read( path ), "a file that is not a log is refused" ) && ok;
+    remove( path );
+    return ok;
+}
+
+bool testEditorUndo()
+{
+    // two strokes, then undo and redo them one at a time: the tiles in view go
+    // back and forth between the three states, and undo and redo stop at the
+    // ends of the history
+    bool ok = true;
+    ChunkManager world( 16, 2, 64 * 1024 * 1024, 3 );
+    Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
+    loadView( world, camera );
+    TileEditor editor;
+    Uint64 start = world.viewDigest( camera );
+    const InputSnapshot released = { 0, 0, 0 };
+    for ( int t=0; t<10; t++ ) {
+        InputSnapshot input = { INPUT_PAINT, 100 + t * 40, 100 + t * 10 };
+        editor.update( input, camera, world );
+    }
+    editor.update( released, camera, world );
+    Uint64 painted = world.viewDigest( camera );
+    for ( int t=0; t<10; t++ ) {
+        InputSnapshot input = { INPUT_ERASE, 120 + t * 40, 100 + t * 10 };
+        editor.update( input, camera, world );
+    }
+    editor.update( released, camera, world );
+    Uint64 erased = world.viewDigest( camera );
+    ok = check( painted != start && erased != painted, "strokes change tiles" ) && ok;
+    ok = check( editor.undo( world ) && world.viewDigest( camera ) == painted, "undo the second stroke" ) && ok;
+    ok = check( editor.undo( world ) && world.viewDigest( camera ) == start, "undo the first stroke" ) && ok;
+    ok = check( !editor.undo( world ), "nothing left to undo" ) && ok;
+    ok = check( editor.redo( world ) && world.viewDigest( camera ) == painted, "redo the first stroke" ) && ok;
+    ok = check( editor.redo( world ) && world.viewDigest( camera ) == erased, "redo the second stroke" ) && ok;
+    ok = check( !editor.redo( world ), "nothing left to redo" ) && ok;
+    return ok;
+}
+
+bool testSimulationNotSaved()
+{
+    // the tile simulation is not persistent on its own: a world saved after
+    // some steps holds the generated tiles of every chunk that was not edited,
+    // and opens to the same view as a world that never ran the simulation.
+    // The edited chunk, out of view, is saved as it is, simulation included
+    bool ok = true;
+    const int length = 32;
+    const Uint32 seed = 8;
+    const char* path = "tests_sim.tmp";
+    const int editX = -16, editY = -16;
+    TerrainGenerator terrain( seed );
+    Chunk edited( length );
+    {
+        ChunkManager world( length, 2, 64 * 1024 * 1024, seed );
+        Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
+        loadView( world, camera );
+        world.setTile( editX * length + 5, editY * length + 5, TILE_METAL );
+        world.setTile( editX * length + 6, editY * length + 5, TILE_METAL );
+        TileSimulation sim( seed );
+        long changed = 0;
+        for ( int s=0; s<20; s++ ) {
+            world.simulate( sim );
+            changed += sim.stats().tilesChanged;
+        }
+        ok = check( changed > 0, "simulation changes tiles" ) && ok;
+        for ( int i=0; i<length; i++ ) {
+            for ( int j=0; j<length; j++ ) {
+                Uint8 type;
+                world.setTile( editX * length + j, editY * length + i, TILE_GRASS, &type );
+                world.setTile( editX * length + j, editY * length + i, type );
+                edited.setType( i, j, type );
+            }
+        }
+        ok = check( world.saveWorld( path ), "simulated world is saved" ) && ok;
+    }
+    WorldFile file;
+    ok = check( file.open( path ) && file.chunkCount() > 1, "saved world opens" ) && ok;
+    Chunk chunk( length ), generated( length );
+    for ( int i=0; i<file.chunkCount(); i++ ) {
+        const WorldFileIndexEntry& entry = file.entries()[ i ];
+        bool read = file.readChunk( { entry.x, entry.y }, chunk );
+        if ( entry.x == editX && entry.y == editY ) {
+            ok = check( read && memcmp( chunk.data(), edited.data(), length * length ) == 0, "edited chunk is saved as it is" ) && ok;
+            continue;
+        }
+        terrain.generate( generated, entry.x * length, entry.y * length );
+        ok = check( read && memcmp( chunk.data(), generated.data(), length * length ) == 0,
+                    "unedited chunks are saved as generated" ) && ok;
+    }
+    file.close();
+
+    // the view, opened from the file and generated
+    Uint64 digests[ 2 ];
+    for ( int opened=0; opened<2; opened++ ) {
+        ChunkManager world( length, 2, 64 * 1024 * 1024, seed );
+        if ( opened ) {
+            ok = check( world.openWorld( path ), "manager opens the saved world" ) && ok;
+        }
+        Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
+        camera.setZoom( 0.5 );
+        loadView( world, camera );
+        digests[ opened ] = world.viewDigest( camera );
+    }
+    ok = check( digests[ 0 ] == digests[ 1 ], "saved world shows the generated tiles" ) && ok;
+    remove( path );
+    return ok;
+}
+
+bool testPipeline()
+{
+    // the same frames through a serial and a threaded pipeline. Threaded, a
+    // list is built from the input of the frame before the one it is shown
+    // in, so its lists are the serial ones one frame later. The zoom goes
+    // below the LOD zoom, so frames the render thread draws are covered too
+    const int frames = 120;
+    std::vector<Uint64> digests[ 2 ];
+    for ( int threaded=0; threaded<2; threaded++ ) {
+        ChunkManager world( 32, 2, 256 * 1024 * 1024, 7 );
+        Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
+        // every chunk the zoomed out view shows is loaded up front, so what
+        // is streamed in does not depend on timing
+        camera.setZoom( 0.05 );
+        loadView( world, camera );
+        camera.setZoom( 1.0 );
+        EntityWorld entities;
+        entities.spawn( 20000, 3 );
+        const SDL_Rect clip = { 0, 0, TILE_W, TILE_H };
+        int zoom = 0, ticks = 0;
+        FramePipeline pipeline( [&]( DrawList& list ) {
+            camera.zoomBy( zoom );
+            zoom = 0;
+            for ( ; ticks>0; ticks-- ) {
+                entities.tick( &world.workers() );
+            }
+            list.clear();
+            list.setScale( camera.getZoom() );
+            list.setNeedsWorld( !world.render( camera, list ) );
+            entities.render( camera, list, gTileTexture, clip );
+        }, threaded != 0 );
+        for ( int f=0; f<frames; f++ ) {
+            pipeline.wait();
+            zoom += f % 80 < 40 ? -1 : 1;
+            ticks++;
+            DrawList& list = pipeline.next();
+            pipeline.start();
+            digests[ threaded ].push_back( ( (Uint64)list.size() << 32 ) ^ ( (Uint64)list.tiles() << 8 ) ^
+                                           (Uint64)( list.getScale() * 1000 ) ^ ( list.needsWorld() ? 1ull << 63 : 0 ) );
+        }
+        pipeline.wait();
+    }
+    bool ok = true;
+    for ( int f=0; f+1<frames; f++ ) {
+        ok = ok && digests[ 0 ][ f ] == digests[ 1 ][ f + 1 ];
+    }
+    return check( ok, "threaded lists match the serial ones a frame later" );
+}
+
+bool testKeptEdits()
+{
+    // edits of evicted chunks outgrow their share of a small memory cap and
+    // are moved to the spill file. Memory stays under the cap, and every edit
+    // comes back when its chunk is loaded again and when the world is saved
+    bool ok = true;
+    const int length = 16;
+    const int edited = 600;
+    const size_t cap = 128 * 1024;
+    const char* path = "tests_kept.tmp";
+    ChunkManager world( length, 1, cap, 5 );
+    Camera camera( SCREEN_WIDTH, SCREEN_HEIGHT );
+    loadView( world, camera );
+    // a checkerboard does not run-length encode, so each record is a full chunk
+    for ( int c=0; c<edited; c++ ) {
+        for ( int i=0; i<length; i++ ) {
+            for ( int j=0; j<length; j++ ) {
+                world.setTile( ( 100 + c ) * length + j, i, ( i + j ) % 2 ? TILE_METAL : TILE_GRASS );
+            }
+        }
+        world.update( camera );
+        ok = check( world.memoryUsed() <= cap || c == 0, "memory stays under the cap" ) && ok;
+    }
+    ok = check( world.stats().spills > 0 && world.keptEditBytes() <= cap / 2, "kept edits are spilled" ) && ok;
+    bool same = true;
+    for ( int c=0; c<edited; c++ ) {
+        for ( int i=0; i<length; i++ ) {
+            for ( int j=0; j<length; j++ ) {
+                Uint8 type;
+                world.setTile( ( 100 + c ) * length + j, i, ( i + j ) % 2 ? TILE_METAL : TILE_GRASS, &type );
+                same = same && type == ( ( i + j ) % 2 ? TILE_METAL : TILE_GRASS );
+            }
+        }
+        world.update( camera );
+    }
+    ok = check( same, "kept edits come back" ) && ok;
+    ok = check( world.saveWorld( path ), "world with kept edits is saved" ) && ok;
+    WorldFile file;
+    ok = check( file.open( path ), "saved world opens" ) && ok;
+    Chunk chunk( length );
+    same = true;
+    for ( int c=0; c<edited; c++ ) {
+        same = same && file.readChunk( { 100 + c, 0 }, chunk );
+        for ( int i=0; same && i<length*length; i++ ) {
+            same = chunk.data()[ i ] == ( ( i / length + i % length ) % 2 ? TILE_METAL : TILE_GRASS );
+        }
+    }
+    ok = check( same, "kept edits are saved" ) && ok;
+    file.close();
+    remove( path );
+    return ok;
+}
+
+int main( int argc, char* argv[] )
+{
+    // checks of the engine with pass/fail results: tests [name]. Runs every
+    // test without a name. Exits with 2 if one fails
+    struct Test {
+        const char* name;
+        bool ( *run )();
+    };
+    const Test tests[] = {
+        { "core", testCore },
+        { "records", testChunkRecords },
+        { "world", testWorldFile },
+        { "terrain", testTerrain },
+        { "inputlog", testInputLog },
+        { "editor", testEditorUndo },
+        { "kept", testKeptEdits },
+        { "simulation", testSimulationNotSaved },
+        { "pipeline", testPipeline }
+    };
+    std::string name = argc > 1 ? argv[ 1 ] : "";
+    bool ok = true;
+    int ran = 0;
+    for ( size_t i=0; i<sizeof( tests ) / sizeof( tests[ 0 ] ); i++ ) {
+        if ( name.empty() || name == tests[ i ].name ) {
+            bool passed = tests[ i ].run();
+            printf( "%-10s %s\n", tests[ i ].name, passed ? "ok" : "FAILED" );
+            ok = ok && passed;
+            ran++;
+        }
+    }
+    if ( ran == 0 ) {
+        printf( "Usage: %s [test]\n", argv[ 0 ] );
+        for ( size_t i=0; i<sizeof( tests ) / sizeof( tests[ 0 ] ); i++ ) {
+            printf( "  %s\n", tests[ i ].name );
+        }
+        return 1;
+    }
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <random>
+
+#include "tile.h"
+
+TileBatch::TileBatch( SDL_Texture* texture )
+{
+    int w = 1, h = 1;
+    this->texture = texture;
+    if ( texture != NULL ) {
+        SDL_QueryTexture( texture, NULL, NULL, &w, &h );
+    }
+    this->texW = w;
+    this->texH = h;
+}
+void TileBatch::add( const SDL_Rect& src, const SDL_Rect& dst )
+{
+    // append one textured quad (two triangles) to the batch
+    const SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    appendQuad( this->vertices, this->indices, src, dst, this->texW, this->texH, white );
+}
+void TileBatch::flush( SDL_Renderer* renderer )
+{
+    // submit everything collected so far with a single draw call. The buffers
+    // are cleared but keep their capacity, so steady frames do not allocate
+    if ( this->indices.empty() ) {
+        return;
+    }
+    SDL_RenderGeometry( renderer, this->texture,
+                        this->vertices.data(), this->vertices.size(),
+                        this->indices.data(), this->indices.size() );
+    gDrawCalls++;
+    this->vertices.clear();
+    this->indices.clear();
+}
+
+Chunk::Chunk( int length, int x, int y )
+{
+    this->len = length;
+    this->x = x;
+    this->y = y;
+    this->types.assign( length * length, TILE_GRASS );
+}
+bool Chunk::visibleRange( const SDL_Rect& view, int& row0, int& row1, int& col0, int& col1 )
+{
+    return visibleTileRange( view, this->x, this->y, this->len, &row0, &row1, &col0, &col1 );
+}
+namespace {
+    // walks the visible tiles of a chunk row by row and hands each to emit with
+    // its screen rect. The row stride is a constant for the common lengths
+    template<typename Emit>
+    struct VisibleTiles {
+        const Uint8* types;
+        int length;
+        int row0, row1, col0, col1;
+        // screen position of the chunk origin
+        int originX, originY;
+        Emit emit;
+
+        template<int Len>
+        void run()
+        {
+            const int len = ChunkLength<Len>::value( this->length );
+            SDL_Rect dstRect = { 0, 0, TILE_W, TILE_H };
+            for ( int i=this->row0; i<this->row1; i++ ) {
+                const Uint8* row = this->types + i*len;
+                dstRect.y = this->originY + i * TILE_H;
+                for ( int j=this->col0; j<this->col1; j++ ) {
+                    dstRect.x = this->originX + j * TILE_W;
+                    this->emit( row[ j ], dstRect );
+                }
+            }
+        }
+    };
+
+    // adds the number of visible tiles to drawn
+    template<typename Emit>
+    void forVisibleTiles( Chunk& chunk, const SDL_Rect& view, int& drawn, Emit emit )
+    {
+        int row0, row1, col0, col1;
+        if ( !chunk.visibleRange( view, row0, row1, col0, col1 ) ) {
+            return;
+        }
+        drawn += ( row1 - row0 ) * ( col1 - col0 );
+        VisibleTiles<Emit> kernel = { chunk.data(), chunk.length(), row0, row1, col0, col1,
+                                      chunk.getX() - view.x, chunk.getY() - view.y, emit };
+        dispatchChunkLength( chunk.length(), kernel );
+    }
+}
+void Chunk::render( Camera& cam )
+{
+    forVisibleTiles( *this, cam.rect(), gTilesDrawn, []( Uint8 type, const SDL_Rect& dst ) {
+        SDL_RenderCopy( gRenderer, gTileTexture, &gTileClips[ type ], &dst );
+        gDrawCalls++;
+    } );
+}
+void Chunk::render( Camera& cam, TileBatch& batch )
+{
+    forVisibleTiles( *this, cam.rect(), gTilesDrawn, [&batch]( Uint8 type, const SDL_Rect& dst ) {
+        batch.add( gTileClips[ type ], dst );
+    } );
+}
+void Chunk::render( Camera& cam, DrawList& list )
+{
+    // records the tiles instead of drawing them. Runs off the render thread,
+    // so the tiles are counted in the list rather than in gTilesDrawn
+    int drawn = 0;
+    forVisibleTiles( *this, cam.rect(), drawn, [&list]( Uint8 type, const SDL_Rect& dst ) {
+        list.add( gTileTexture, gTileClips[ type ], dst );
+    } );
+    list.addTiles( drawn );
+}
+
+void loadChunk( Chunk& chunk, unsigned int seed )
+{
+    // each chunk gets its own generator so chunks can be built on any thread
+    std::minstd_rand rng( seed );
+    for ( int i=0; i<chunk.length(); i++ ) {
+        for ( int j=0; j<chunk.length(); j++ ) {
+            chunk.setType( i, j, rng()%2 );
+        }
+    }
+}
+
+TileMask::TileMask()
+{
+    this->len = 0;
+    this->setCount = 0;
+    this->minCol = this->maxCol = 0;
+    this->minRow = this->maxRow = 0;
+}
+void TileMask::set( int length, int row, int col )
+{
+    // sized by the first tile set, so a chunk that is never edited pays nothing
+    if ( this->len != length ) {
+        this->len = length;
+        this->bits.assign( ( (size_t)length * length + 63 ) / 64, 0 );
+        this->setCount = 0;
+    }
+    size_t index = (size_t)row * length + col;
+    Uint64 bit = 1ull << ( index % 64 );
+    if ( this->bits[ index / 64 ] & bit ) {
+        return;
+    }
+    this->bits[ index / 64 ] |= bit;
+    if ( this->setCount == 0 ) {
+        this->minCol = col;
+        this->maxCol = col + 1;
+        this->minRow = row;
+        this->maxRow = row + 1;
+    }
+    else {
+        this->minCol = std::min( this->minCol, col );
+        this->maxCol = std::max( this->maxCol, col + 1 );
+        this->minRow = std::min( this->minRow, row );
+        this->maxRow = std::max( this->maxRow, row + 1 );
+    }
+    this->setCount++;
+}
+void TileMask::clear()
+{
+    if ( this->setCount == 0 ) {
+        return;
+    }
+    size_t first = ( (size_t)this->minRow * this->len ) / 64;
+    size_t last = ( (size_t)this->maxRow * this->len + 63 ) / 64;
+    std::fill( this->bits.begin() + first, this->bits.begin() + last, 0 );
+    this->setCount = 0;
+    this->minCol = this->maxCol = 0;
+    this->minRow = this->maxRow = 0;
+}
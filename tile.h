@@ -0,0 +1,143 @@
+#ifndef FERMI_TILE_H
+#define FERMI_TILE_H
+
+#include <vector>
+#include <functional>
+
+#include "common.h"
+#include "camera.h"
+#include "drawlist.h"
+
+class TileBatch {
+public:
+    TileBatch( SDL_Texture* texture );
+    void add( const SDL_Rect& src, const SDL_Rect& dst );
+    void flush( SDL_Renderer* renderer );
+
+    int size() { return this->indices.size() / 6; };
+private:
+    // every quad pushed into the batch samples from this texture
+    SDL_Texture* texture;
+    float texW, texH;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+struct ChunkKey {
+    int x;
+    int y;
+
+    bool operator==( const ChunkKey& other ) const
+    {
+        return ( other.x == x && other.y == y );
+    }
+};
+
+struct ChunkKeyHash {
+    size_t operator()( const ChunkKey& k ) const
+    {
+        return std::hash<long long>()( ( (long long)k.x << 32 ) ^ (unsigned int)k.y );
+    }
+};
+
+// Tiles of a chunk stored as one byte per tile in row major order. Positions
+// are not stored; they follow from the tile index and the chunk origin
+class Chunk {
+public:
+    Chunk( int length, int x=0, int y=0 );
+    void render( Camera& cam );
+    void render( Camera& cam, TileBatch& batch );
+    void render( Camera& cam, DrawList& list );
+    bool visibleRange( const SDL_Rect& view, int& row0, int& row1, int& col0, int& col1 );
+
+    int length() { return this->len; };
+    int getX() { return this->x; };
+    int getY() { return this->y; };
+    Uint8 getType( int row, int col ) { return this->types[ row*this->len + col ]; };
+    void setType( int row, int col, Uint8 type ) { this->types[ row*this->len + col ] = type; };
+    Uint8* data() { return this->types.data(); };
+    size_t bytes() { return sizeof( Chunk ) + this->types.size(); };
+    SDL_Rect tileRect( int row, int col )
+    {
+        SDL_Rect rect = { this->x + col * TILE_W, this->y + row * TILE_H, TILE_W, TILE_H };
+        return rect;
+    };
+private:
+    int len;
+    // world position of the top left corner in pixels
+    int x, y;
+    std::vector<Uint8> types;
+};
+
+void loadChunk( Chunk& chunk, unsigned int seed );
+
+// One bit per tile of a chunk, in the same row major order as its types. Keeps
+// the bounding rect of the set tiles, so clearing and walking a few edits in a
+// large chunk only touch the rows they are in
+class TileMask {
+public:
+    TileMask();
+    void set( int length, int row, int col );
+    void clear();
+    template<typename Fn>
+    void forEach( Fn fn ) const;
+
+    int count() const { return this->setCount; };
+    bool empty() const { return this->setCount == 0; };
+    // half open rect of columns and rows holding every set tile
+    int col0() const { return this->minCol; };
+    int col1() const { return this->maxCol; };
+    int row0() const { return this->minRow; };
+    int row1() const { return this->maxRow; };
+private:
+    int len;
+    int setCount;
+    int minCol, maxCol, minRow, maxRow;
+    std::vector<Uint64> bits;
+};
+
+template<typename Fn>
+void TileMask::forEach( Fn fn ) const
+{
+    // calls fn( row, col ) for every set tile in row major order
+    if ( this->setCount == 0 ) {
+        return;
+    }
+    size_t first = ( (size_t)this->minRow * this->len + this->minCol ) / 64;
+    size_t last = ( (size_t)( this->maxRow - 1 ) * this->len + this->maxCol - 1 ) / 64;
+    for ( size_t w=first; w<=last; w++ ) {
+        Uint64 word = this->bits[ w ];
+        while ( word != 0 ) {
+            int index = w * 64 + __builtin_ctzll( word );
+            fn( index / this->len, index % this->len );
+            word &= word - 1;
+        }
+    }
+}
+
+// Chunk length as a compile-time constant for loops over whole chunks. Len 0
+// is the generic path that reads the length at run time
+template<int Len>
+struct ChunkLength {
+    static int value( int ) { return Len; }
+};
+template<>
+struct ChunkLength<0> {
+    static int value( int length ) { return length; }
+};
+
+// Calls kernel.run<Len>() specialized for the common chunk lengths, so the
+// compiler can unroll and vectorize them; other lengths run run<0>()
+template<typename Kernel>
+void dispatchChunkLength( int length, Kernel& kernel )
+{
+    switch ( length ) {
+        case 16: kernel.template run<16>(); break;
+        case 32: kernel.template run<32>(); break;
+        case 64: kernel.template run<64>(); break;
+        case 128: kernel.template run<128>(); break;
+        default: kernel.template run<0>(); break;
+    }
+}
+
+#endif
@@ -0,0 +1,112 @@
+#include <string.h>
+
+#include "tilesim.h"
+#include "profiler.h"
+
+// the update counts neighbours by comparing with these
+static_assert( TILE_GRASS == 0 && TILE_METAL == 1, "tile simulation assumes grass 0, metal 1" );
+
+namespace {
+    inline Uint32 tileHash( Uint32 seed, int x, int y )
+    {
+        // 16 random bits per tile and step
+        Uint32 h = (Uint32)x * 0x8DA6B343u ^ (Uint32)y * 0xD8163841u ^ seed;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        h *= 0x297A2D39u;
+        h ^= h >> 15;
+        return h & 0xFFFF;
+    }
+};
+
+TileSimulation::TileSimulation( Uint32 seed )
+{
+    this->seed = seed;
+    this->counters = { 0, 0, 0, 0.0 };
+}
+void TileSimulation::step( std::vector<SimChunk>& chunks, JobSystem& jobs )
+{
+    // both passes split the chunks across the workers; the second starts once
+    // every snapshot is taken
+    PROFILE_ZONE( "tile simulation" );
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint32 stepSeed = this->seed ^ (Uint32)this->counters.steps * 0x9E3779B9u;
+    jobs.parallelFor( chunks.size(), [&]( int begin, int end ) {
+        for ( int i=begin; i<end; i++ ) {
+            this->snapshot( chunks[ i ] );
+        }
+    } );
+    jobs.parallelFor( chunks.size(), [&]( int begin, int end ) {
+        for ( int i=begin; i<end; i++ ) {
+            this->update( chunks[ i ], stepSeed );
+        }
+    } );
+    long changed = 0;
+    for ( size_t i=0; i<chunks.size(); i++ ) {
+        changed += chunks[ i ].changed.size();
+    }
+    this->counters.steps++;
+    this->counters.chunks = chunks.size();
+    this->counters.tilesChanged = changed;
+    this->counters.ms = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+void TileSimulation::snapshot( SimChunk& sim )
+{
+    // ( length + 2 )^2 tiles: the chunk in the middle, the last column of the
+    // chunk to the left on the left and so on
+    using namespace tilesim_constants;
+    int len = sim.neighbours[ 1 ][ 1 ]->length();
+    int stride = len + 2;
+    sim.before.resize( stride * stride );
+    for ( int i=-1; i<=len; i++ ) {
+        int ny = i < 0 ? 0 : ( i < len ? 1 : 2 );
+        int row = i < 0 ? len - 1 : ( i < len ? i : 0 );
+        Chunk* left = sim.neighbours[ ny ][ 0 ];
+        Chunk* middle = sim.neighbours[ ny ][ 1 ];
+        Chunk* right = sim.neighbours[ ny ][ 2 ];
+        Uint8* out = sim.before.data() + ( i + 1 ) * stride;
+        out[ 0 ] = left != NULL ? left->getType( row, len - 1 ) : missingTile;
+        if ( middle != NULL ) {
+            memcpy( out + 1, middle->data() + row * len, len );
+        }
+        else {
+            memset( out + 1, missingTile, len );
+        }
+        out[ len + 1 ] = right != NULL ? right->getType( row, 0 ) : missingTile;
+    }
+}
+void TileSimulation::update( SimChunk& sim, Uint32 stepSeed )
+{
+    // reads the snapshot, writes the chunk. Grass never changes, so only metal
+    // tiles count their neighbours and roll
+    using namespace tilesim_constants;
+    Chunk& chunk = *sim.neighbours[ 1 ][ 1 ];
+    int len = chunk.length();
+    int stride = len + 2;
+    int tileX0 = floorDiv( chunk.getX(), TILE_W );
+    int tileY0 = floorDiv( chunk.getY(), TILE_H );
+    Uint8* types = chunk.data();
+    sim.changed.clear();
+    for ( int i=0; i<len; i++ ) {
+        const Uint8* up = sim.before.data() + i * stride + 1;
+        const Uint8* row = up + stride;
+        const Uint8* down = row + stride;
+        for ( int j=0; j<len; j++ ) {
+            if ( row[ j ] != TILE_METAL ) {
+                continue;
+            }
+            int grass = ( up[ j - 1 ] == TILE_GRASS ) + ( up[ j ] == TILE_GRASS ) + ( up[ j + 1 ] == TILE_GRASS )
+                      + ( row[ j - 1 ] == TILE_GRASS ) + ( row[ j + 1 ] == TILE_GRASS )
+                      + ( down[ j - 1 ] == TILE_GRASS ) + ( down[ j ] == TILE_GRASS ) + ( down[ j + 1 ] == TILE_GRASS );
+            int metal = ( up[ j - 1 ] == TILE_METAL ) + ( up[ j ] == TILE_METAL ) + ( up[ j + 1 ] == TILE_METAL )
+                      + ( row[ j - 1 ] == TILE_METAL ) + ( row[ j + 1 ] == TILE_METAL )
+                      + ( down[ j - 1 ] == TILE_METAL ) + ( down[ j ] == TILE_METAL ) + ( down[ j + 1 ] == TILE_METAL );
+            Uint32 chance = grass * spreadChance + ( metal <= corrodeNeighbours ? corrodeChance : 0 );
+            if ( chance > 0 && tileHash( stepSeed, tileX0 + j, tileY0 + i ) < chance ) {
+                types[ i * len + j ] = TILE_GRASS;
+                sim.changed.push_back( i * len + j );
+            }
+        }
+    }
+}
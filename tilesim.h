@@ -0,0 +1,63 @@
+#ifndef FERMI_TILESIM_H
+#define FERMI_TILESIM_H
+
+#include <vector>
+
+#include "common.h"
+#include "tile.h"
+#include "jobs.h"
+
+namespace tilesim_constants {
+    // the tiles change once every this many simulation ticks, 10 times a second
+    const int ticksPerStep = 6;
+    // chance per step, out of 65536, that a metal tile turns to grass for each
+    // grass tile among its 8 neighbours
+    const Uint32 spreadChance = 48;
+    // metal with at most corrodeNeighbours metal neighbours corrodes to grass
+    // with a chance of corrodeChance out of 65536 per step
+    const int corrodeNeighbours = 2;
+    const Uint32 corrodeChance = 512;
+    // border tiles of chunks that are not loaded, counted as neither type
+    const Uint8 missingTile = 0xFF;
+};
+
+// A chunk taking part in a step and the chunks around it: neighbours[ 1 ][ 1 ]
+// is the chunk itself, [ 0 ][ 0 ] the one above and to the left. Neighbours
+// that are not loaded are NULL
+struct SimChunk {
+    Chunk* neighbours[ 3 ][ 3 ];
+    // after a step, the tiles that changed as row * length + col
+    std::vector<int> changed;
+    // the tiles before the step with a one tile border from the neighbours
+    std::vector<Uint8> before;
+};
+
+struct TileSimStats {
+    long steps;
+    // of the last step
+    int chunks;
+    long tilesChanged;
+    double ms;
+};
+
+// Per tile dynamics over every chunk given to step(): grass spreads onto metal
+// next to it and lone metal corrodes away. A step first copies every chunk's
+// tiles with a border from its neighbours, then computes the new tiles from
+// those copies alone, so no thread reads tiles another one is writing. Random
+// choices hash the seed, the step number and the tile's world position, so the
+// result is the same for any number of threads and any order of the chunks
+class TileSimulation {
+public:
+    TileSimulation( Uint32 seed );
+    void step( std::vector<SimChunk>& chunks, JobSystem& jobs );
+
+    TileSimStats& stats() { return this->counters; };
+private:
+    void snapshot( SimChunk& sim );
+    void update( SimChunk& sim, Uint32 stepSeed );
+
+    Uint32 seed;
+    TileSimStats counters;
+};
+
+#endif
@@ -0,0 +1,724 @@
+#include <algorithm>
+#include <thread>
+
+#include <unistd.h>
+
+#include "world.h"
+#include "profiler.h"
+
+namespace world_constants {
+    // chunks beyond the view that are generated ahead of time
+    const int prefetchMargin = 1;
+    // below this zoom tiles are smaller than 4 pixels on screen and chunks are
+    // drawn from their LOD image instead
+    const double lodZoom = 4.0 / TILE_W;
+    // below this zoom too many chunks are in view to keep a full resolution
+    // texture for each, and the cached renderer falls back to batching
+    const double bakedZoom = 0.5;
+    // chunk textures not drawn for this many frames are released
+    const int bakedKeepFrames = 60;
+    // changed rects beyond this many are merged into their bounding box
+    const size_t maxChanges = 64;
+    // kept edits may use up to this share of the memory cap before they are
+    // moved to the spill file
+    const double keptEditsShare = 0.5;
+};
+
+ChunkManager::ChunkManager( int chunkLength, int workers, size_t memoryCap, Uint32 seed )
+    : terrain( seed ), jobs( workers )
+{
+    this->len = chunkLength;
+    this->memoryCap = memoryCap;
+    this->frame = 0;
+    this->counters = { 0, 0, 0, 0, 0, 0, 0 };
+    this->keptBytes = 0;
+    this->spillEnd = 0;
+    this->spilledCount = 0;
+    FILE* spill = tmpfile();
+    if ( spill == NULL ) {
+        printf( "Unable to create a spill file, kept edits stay in memory!\n" );
+    }
+    else {
+        this->spillFile.reset( spill, fclose );
+    }
+    this->maxTextureSize = 0;
+    this->queuedJobs = 0;
+}
+ChunkManager::~ChunkManager()
+{
+    // queued jobs are dropped by the job system; running ones find nothing pending
+    std::lock_guard<std::mutex> lock( this->jobMutex );
+    this->pending.clear();
+}
+size_t ChunkManager::chunkBytes()
+{
+    // tile types and the LOD pixels. LOD textures live in video memory
+    return sizeof( Chunk ) + sizeof( ChunkLod ) + this->len * this->len * ( sizeof( Uint8 ) + sizeof( Uint32 ) );
+}
+int ChunkManager::pendingChunks()
+{
+    std::lock_guard<std::mutex> lock( this->jobMutex );
+    return this->pending.size() + this->inFlight.size();
+}
+void ChunkManager::keyRange( const SDL_Rect& view, int margin, int& cx0, int& cx1, int& cy0, int& cy1 )
+{
+    // chunk coordinates overlapping the view, grown by margin chunks. The range
+    // is inclusive on both ends
+    int chunkW = this->len * TILE_W;
+    int chunkH = this->len * TILE_H;
+    cx0 = floorDiv( view.x, chunkW ) - margin;
+    cx1 = floorDiv( view.x + view.w - 1, chunkW ) + margin;
+    cy0 = floorDiv( view.y, chunkH ) - margin;
+    cy1 = floorDiv( view.y + view.h - 1, chunkH ) + margin;
+}
+ChunkManager::Entry* ChunkManager::find( const ChunkKey& key )
+{
+    auto it = this->cache.find( key );
+    if ( it == this->cache.end() ) {
+        this->counters.misses++;
+        return NULL;
+    }
+    this->counters.hits++;
+    Entry& entry = it->second;
+    entry.lastUsedFrame = this->frame;
+    this->lru.splice( this->lru.begin(), this->lru, entry.lruPos );
+    return &entry;
+}
+void ChunkManager::collectFinished()
+{
+    std::vector<Built> built;
+    {
+        std::lock_guard<std::mutex> lock( this->jobMutex );
+        built.swap( this->finished );
+        for ( size_t i=0; i<built.size(); i++ ) {
+            this->inFlight.erase( built[ i ].key );
+        }
+    }
+    for ( size_t i=0; i<built.size(); i++ ) {
+        this->insertBuilt( built[ i ] );
+    }
+}
+void ChunkManager::insertBuilt( Built& built )
+{
+    this->lru.push_front( built.key );
+    Entry& entry = this->cache[ built.key ];
+    entry.chunk = std::move( built.chunk );
+    entry.lod = std::move( built.lod );
+    entry.lruPos = this->lru.begin();
+    entry.lastUsedFrame = this->frame;
+    entry.lastDrawnFrame = this->frame;
+    entry.fromFile = built.fromFile;
+    // kept edits are only in memory until the next save
+    entry.modified = built.fromEdits;
+    this->addChange( { entry.chunk->getX(), entry.chunk->getY(), this->len * TILE_W, this->len * TILE_H } );
+    if ( built.fromEdits ) {
+        this->eraseKeptEdits( built.key );
+    }
+    if ( built.fromFile || built.fromEdits ) {
+        this->counters.loaded++;
+    }
+    else {
+        this->counters.generated++;
+    }
+}
+void ChunkManager::addChange( const SDL_Rect& rect )
+{
+    // bounded whether or not anyone takes the changes
+    if ( this->changes.size() < world_constants::maxChanges ) {
+        this->changes.push_back( rect );
+        return;
+    }
+    SDL_Rect merged = this->changes.back();
+    SDL_UnionRect( &merged, &rect, &this->changes.back() );
+}
+void ChunkManager::eraseKeptEdits( const ChunkKey& key )
+{
+    std::lock_guard<std::mutex> lock( this->jobMutex );
+    auto it = this->evictedEdits.find( key );
+    if ( it != this->evictedEdits.end() ) {
+        this->keptBytes -= sizeof( ChunkKey ) + sizeof( EditedRecord ) + it->second.record.size();
+        this->spilledCount -= it->second.spilled;
+        this->evictedEdits.erase( it );
+    }
+}
+void ChunkManager::spillKeptEdits()
+{
+    // kept edits are unsaved work, so they are never dropped. Past their share
+    // of the cap records are appended to the spill file and read back from
+    // there when their chunk returns or the world is saved. Only the records
+    // over the share are moved, usually the one evicted last, so this is a
+    // small write into the page cache. The world file is only written by an
+    // explicit save
+    if ( this->spillFile == NULL ) {
+        return;
+    }
+    int fd = fileno( this->spillFile.get() );
+    {
+        // with nothing left in the file and no job holding an offset into it,
+        // it starts over instead of growing for the whole session
+        std::lock_guard<std::mutex> lock( this->jobMutex );
+        if ( this->spilledCount == 0 && this->spillEnd > 0 && this->inFlight.empty() && ftruncate( fd, 0 ) == 0 ) {
+            this->spillEnd = 0;
+        }
+    }
+    size_t share = this->memoryCap * world_constants::keptEditsShare;
+    for ( auto it=this->evictedEdits.begin(); it!=this->evictedEdits.end() && this->keptBytes>share; it++ ) {
+        // only this thread changes the records, so they are read without the lock
+        EditedRecord& edited = it->second;
+        if ( edited.spilled ) {
+            continue;
+        }
+        Uint32 size = edited.record.size();
+        if ( pwrite( fd, edited.record.data(), size, this->spillEnd ) != (ssize_t)size ) {
+            // the disk is full; the records stay in memory
+            return;
+        }
+        std::lock_guard<std::mutex> lock( this->jobMutex );
+        edited.spilled = true;
+        edited.spillSize = size;
+        edited.spillOffset = this->spillEnd;
+        std::vector<Uint8>().swap( edited.record );
+        this->spillEnd += size;
+        this->keptBytes -= size;
+        this->spilledCount++;
+        this->counters.spills++;
+    }
+}
+bool ChunkManager::readSpilled( EditedRecord& edited )
+{
+    // bring a spilled record back into memory. pread does not move the file
+    // position, so any thread may call this
+    if ( !edited.spilled ) {
+        return true;
+    }
+    edited.record.resize( edited.spillSize );
+    if ( this->spillFile == NULL ||
+         pread( fileno( this->spillFile.get() ), edited.record.data(), edited.spillSize, edited.spillOffset ) != (ssize_t)edited.spillSize ) {
+        return false;
+    }
+    edited.spilled = false;
+    return true;
+}
+void ChunkManager::takeChanges( std::vector<SDL_Rect>& rects )
+{
+    rects.clear();
+    rects.swap( this->changes );
+}
+Uint64 ChunkManager::viewDigest( Camera& cam )
+{
+    // FNV-1a hash of the type of every tile in view, chunks that are not
+    // loaded hashed as missing. Runs that showed the same tiles agree
+    Uint64 h = 14695981039346656037ull;
+    int cx0, cx1, cy0, cy1;
+    this->keyRange( cam.rect(), 0, cx0, cx1, cy0, cy1 );
+    for ( int cy=cy0; cy<=cy1; cy++ ) {
+        for ( int cx=cx0; cx<=cx1; cx++ ) {
+            auto it = this->cache.find( { cx, cy } );
+            int row0, row1, col0, col1;
+            if ( it == this->cache.end() ) {
+                h = ( h ^ 0xFF ) * 1099511628211ull;
+                continue;
+            }
+            Chunk& chunk = *it->second.chunk;
+            if ( !chunk.visibleRange( cam.rect(), row0, row1, col0, col1 ) ) {
+                continue;
+            }
+            for ( int i=row0; i<row1; i++ ) {
+                for ( int j=col0; j<col1; j++ ) {
+                    h = ( h ^ chunk.getType( i, j ) ) * 1099511628211ull;
+                }
+            }
+        }
+    }
+    return h;
+}
+void ChunkManager::evict()
+{
+    // drop least recently used chunks until the cache fits in the memory cap.
+    // Chunks used this frame are never evicted, so a cap smaller than the view
+    // only stops the cache from growing past what is on screen
+    while ( this->memoryUsed() > this->memoryCap && !this->lru.empty() ) {
+        ChunkKey key = this->lru.back();
+        auto it = this->cache.find( key );
+        if ( it->second.lastUsedFrame == this->frame ) {
+            break;
+        }
+        if ( it->second.modified ) {
+            // unsaved edits are kept as a compact record and win over the
+            // world file and the generator when the chunk comes back
+            EditedRecord edited;
+            edited.encoding = encodeChunkRecord( it->second.chunk->data(), this->len, edited.record );
+            edited.spilled = false;
+            edited.spillSize = 0;
+            edited.spillOffset = 0;
+            this->eraseKeptEdits( key );
+            this->keptBytes += sizeof( ChunkKey ) + sizeof( EditedRecord ) + edited.record.size();
+            std::lock_guard<std::mutex> lock( this->jobMutex );
+            this->evictedEdits[ key ] = std::move( edited );
+            this->counters.keptEdits++;
+        }
+        this->cache.erase( it );
+        this->lru.pop_back();
+        this->counters.evictions++;
+    }
+}
+void ChunkManager::update( Camera& cam )
+{
+    PROFILE_ZONE( "world update" );
+    this->frame++;
+    this->collectFinished();
+
+    // rebuild the request queue from scratch, nearest chunks first, so chunks
+    // the camera has already left are never generated
+    int cx0, cx1, cy0, cy1;
+    this->keyRange( cam.rect(), world_constants::prefetchMargin, cx0, cx1, cy0, cy1 );
+    SDL_Rect& view = cam.rect();
+    double centerX = ( view.x + view.w / 2.0 ) / ( this->len * TILE_W );
+    double centerY = ( view.y + view.h / 2.0 ) / ( this->len * TILE_H );
+    std::vector<ChunkKey> wanted;
+    for ( int cy=cy0; cy<=cy1; cy++ ) {
+        for ( int cx=cx0; cx<=cx1; cx++ ) {
+            ChunkKey key = { cx, cy };
+            auto it = this->cache.find( key );
+            if ( it != this->cache.end() ) {
+                // keep prefetched chunks alive without counting a lookup
+                it->second.lastUsedFrame = this->frame;
+                this->lru.splice( this->lru.begin(), this->lru, it->second.lruPos );
+            }
+            else {
+                wanted.push_back( key );
+            }
+        }
+    }
+    std::sort( wanted.begin(), wanted.end(), [&]( const ChunkKey& a, const ChunkKey& b ) {
+        double da = ( a.x + 0.5 - centerX ) * ( a.x + 0.5 - centerX ) + ( a.y + 0.5 - centerY ) * ( a.y + 0.5 - centerY );
+        double db = ( b.x + 0.5 - centerX ) * ( b.x + 0.5 - centerX ) + ( b.y + 0.5 - centerY ) * ( b.y + 0.5 - centerY );
+        return da < db;
+    } );
+    int submit;
+    {
+        std::lock_guard<std::mutex> lock( this->jobMutex );
+        this->pending.clear();
+        for ( size_t i=0; i<wanted.size(); i++ ) {
+            if ( this->inFlight.count( wanted[ i ] ) == 0 ) {
+                this->pending.push_back( wanted[ i ] );
+            }
+        }
+        submit = (int)this->pending.size() - this->queuedJobs;
+        this->queuedJobs += std::max( submit, 0 );
+    }
+    for ( int i=0; i<submit; i++ ) {
+        this->jobs.submit( [this]() { this->generateNext(); } );
+    }
+
+    this->evict();
+    this->spillKeptEdits();
+    this->releaseUnusedTextures();
+}
+void ChunkManager::releaseUnusedTextures()
+{
+    // full resolution chunk textures are large, keep them only for chunks that
+    // were drawn recently
+    for ( auto it=this->cache.begin(); it!=this->cache.end(); it++ ) {
+        Entry& entry = it->second;
+        if ( entry.baked.baked() && this->frame - entry.lastDrawnFrame > world_constants::bakedKeepFrames ) {
+            entry.baked.release();
+        }
+    }
+}
+void ChunkManager::render( Camera& cam )
+{
+    if ( cam.getZoom() < world_constants::lodZoom ) {
+        this->renderLod( cam );
+        return;
+    }
+    int cx0, cx1, cy0, cy1;
+    this->keyRange( cam.rect(), 0, cx0, cx1, cy0, cy1 );
+    for ( int cy=cy0; cy<=cy1; cy++ ) {
+        for ( int cx=cx0; cx<=cx1; cx++ ) {
+            Entry* entry = this->find( { cx, cy } );
+            if ( entry != NULL ) {
+                entry->chunk->render( cam );
+            }
+        }
+    }
+}
+void ChunkManager::render( Camera& cam, TileBatch& batch )
+{
+    if ( cam.getZoom() < world_constants::lodZoom ) {
+        this->renderLod( cam );
+        return;
+    }
+    int cx0, cx1, cy0, cy1;
+    this->keyRange( cam.rect(), 0, cx0, cx1, cy0, cy1 );
+    for ( int cy=cy0; cy<=cy1; cy++ ) {
+        for ( int cx=cx0; cx<=cx1; cx++ ) {
+            Entry* entry = this->find( { cx, cy } );
+            if ( entry != NULL ) {
+                entry->chunk->render( cam, batch );
+            }
+        }
+    }
+}
+bool ChunkManager::render( Camera& cam, DrawList& list )
+{
+    // records the tiles in view without calling the renderer, so it may run
+    // off the render thread. LOD textures are made and updated by the render
+    // thread, so zoomed out that far nothing is recorded and it returns false;
+    // the caller then draws the world on the render thread with render( cam )
+    if ( cam.getZoom() < world_constants::lodZoom ) {
+        return false;
+    }
+    int cx0, cx1, cy0, cy1;
+    this->keyRange( cam.rect(), 0, cx0, cx1, cy0, cy1 );
+    for ( int cy=cy0; cy<=cy1; cy++ ) {
+        for ( int cx=cx0; cx<=cx1; cx++ ) {
+            Entry* entry = this->find( { cx, cy } );
+            if ( entry != NULL ) {
+                entry->chunk->render( cam, list );
+            }
+        }
+    }
+    return true;
+}
+void ChunkManager::renderLod( Camera& cam )
+{
+    // one textured quad per chunk, so the cost depends on the number of chunks
+    // in view and not on the number of tiles
+    int cx0, cx1, cy0, cy1;
+    this->keyRange( cam.rect(), 0, cx0, cx1, cy0, cy1 );
+    for ( int cy=cy0; cy<=cy1; cy++ ) {
+        for ( int cx=cx0; cx<=cx1; cx++ ) {
+            Entry* entry = this->find( { cx, cy } );
+            if ( entry != NULL ) {
+                Chunk& chunk = *entry->chunk;
+                SDL_Rect dst = { chunk.getX() - cam.rect().x, chunk.getY() - cam.rect().y,
+                                 this->len * TILE_W, this->len * TILE_H };
+                entry->lod->render( gRenderer, dst );
+            }
+        }
+    }
+}
+void ChunkManager::renderCached( Camera& cam, TileBatch& batch )
+{
+    if ( cam.getZoom() < world_constants::lodZoom ) {
+        this->renderLod( cam );
+        return;
+    }
+    if ( this->maxTextureSize == 0 ) {
+        SDL_RendererInfo info;
+        SDL_GetRendererInfo( gRenderer, &info );
+        // a renderer without a limit reports 0
+        this->maxTextureSize = info.max_texture_width > 0 ? std::min( info.max_texture_width, info.max_texture_height ) : -1;
+    }
+    bool fits = this->maxTextureSize < 0 || this->len * std::max( TILE_W, TILE_H ) <= this->maxTextureSize;
+    if ( !fits || cam.getZoom() < world_constants::bakedZoom ) {
+        this->render( cam, batch );
+        return;
+    }
+    int cx0, cx1, cy0, cy1;
+    this->keyRange( cam.rect(), 0, cx0, cx1, cy0, cy1 );
+    for ( int cy=cy0; cy<=cy1; cy++ ) {
+        for ( int cx=cx0; cx<=cx1; cx++ ) {
+            Entry* entry = this->find( { cx, cy } );
+            if ( entry == NULL ) {
+                continue;
+            }
+            Chunk& chunk = *entry->chunk;
+            SDL_Rect dst = { chunk.getX() - cam.rect().x, chunk.getY() - cam.rect().y,
+                             this->len * TILE_W, this->len * TILE_H };
+            entry->lastDrawnFrame = this->frame;
+            if ( !entry->baked.render( gRenderer, chunk, dst ) ) {
+                chunk.render( cam, batch );
+            }
+        }
+    }
+    batch.flush( gRenderer );
+}
+void ChunkManager::releaseTextures()
+{
+    // must run while the renderer is still alive
+    for ( auto it=this->cache.begin(); it!=this->cache.end(); it++ ) {
+        it->second.lod->releaseTexture();
+        it->second.baked.release();
+    }
+}
+void ChunkManager::invalidateTextures()
+{
+    // after SDL_RENDER_TARGETS_RESET the content of every target texture is gone
+    for ( auto it=this->cache.begin(); it!=this->cache.end(); it++ ) {
+        it->second.baked.invalidate();
+    }
+}
+bool ChunkManager::setTile( int tileX, int tileY, Uint8 type, Uint8* previous )
+{
+    // change one tile by world tile coordinates and update everything derived
+    // from it: the LOD pixel now, the chunk texture and the world file record
+    // when they are next used. A chunk that is not loaded is built first.
+    // Returns whether the tile changed; previous receives its old type
+    ChunkKey key = { floorDiv( tileX, this->len ), floorDiv( tileY, this->len ) };
+    auto it = this->cache.find( key );
+    Entry* entry = it != this->cache.end() ? &it->second : this->loadNow( key );
+    int row = tileY - key.y * this->len;
+    int col = tileX - key.x * this->len;
+    Uint8 old = entry->chunk->getType( row, col );
+    if ( previous != NULL ) {
+        *previous = old;
+    }
+    if ( old == type ) {
+        return false;
+    }
+    entry->chunk->setType( row, col, type );
+    entry->lod->setTile( row, col, type );
+    entry->baked.invalidateTile( *entry->chunk, row, col );
+    entry->modified = true;
+    this->addChange( { tileX * TILE_W, tileY * TILE_H, TILE_W, TILE_H } );
+    return true;
+}
+void ChunkManager::simulate( TileSimulation& sim )
+{
+    // one step of tile dynamics over every loaded chunk on the workers, then
+    // the updates setTile makes for each changed tile, on this thread. The
+    // changes are not edits and are never persistent on their own: a chunk
+    // is not marked modified by them, so eviction drops them and saveWorld
+    // writes the chunk's file or generated tiles instead. Only a chunk that
+    // was also edited keeps them, as its record holds the whole chunk
+    this->simChunks.resize( this->cache.size() );
+    this->simEntries.resize( this->cache.size() );
+    size_t n = 0;
+    for ( auto it=this->cache.begin(); it!=this->cache.end(); it++, n++ ) {
+        SimChunk& chunk = this->simChunks[ n ];
+        for ( int dy=0; dy<3; dy++ ) {
+            for ( int dx=0; dx<3; dx++ ) {
+                auto neighbour = this->cache.find( { it->first.x + dx - 1, it->first.y + dy - 1 } );
+                chunk.neighbours[ dy ][ dx ] = neighbour != this->cache.end() ? neighbour->second.chunk.get() : NULL;
+            }
+        }
+        this->simEntries[ n ] = &it->second;
+    }
+    sim.step( this->simChunks, this->jobs );
+    for ( size_t i=0; i<this->simChunks.size(); i++ ) {
+        std::vector<int>& changed = this->simChunks[ i ].changed;
+        if ( changed.empty() ) {
+            continue;
+        }
+        Entry& entry = *this->simEntries[ i ];
+        int row0 = this->len, row1 = 0, col0 = this->len, col1 = 0;
+        for ( size_t c=0; c<changed.size(); c++ ) {
+            int row = changed[ c ] / this->len;
+            int col = changed[ c ] % this->len;
+            entry.lod->setTile( row, col, entry.chunk->getType( row, col ) );
+            entry.baked.invalidateTile( *entry.chunk, row, col );
+            row0 = std::min( row0, row );
+            row1 = std::max( row1, row + 1 );
+            col0 = std::min( col0, col );
+            col1 = std::max( col1, col + 1 );
+        }
+        this->addChange( { entry.chunk->getX() + col0 * TILE_W, entry.chunk->getY() + row0 * TILE_H,
+                           ( col1 - col0 ) * TILE_W, ( row1 - row0 ) * TILE_H } );
+    }
+}
+ChunkManager::Entry* ChunkManager::loadNow( const ChunkKey& key )
+{
+    // build a chunk on this thread. If a job is building it already, wait for
+    // that job instead; the chunk must never be built twice, or the second
+    // copy could miss edits made to the first
+    while ( true ) {
+        this->collectFinished();
+        auto it = this->cache.find( key );
+        if ( it != this->cache.end() ) {
+            return &it->second;
+        }
+        bool building;
+        {
+            std::lock_guard<std::mutex> lock( this->jobMutex );
+            building = this->inFlight.count( key ) != 0;
+            if ( !building ) {
+                this->pending.erase( std::remove( this->pending.begin(), this->pending.end(), key ), this->pending.end() );
+            }
+        }
+        if ( !building ) {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    std::shared_ptr<WorldFile> file;
+    EditedRecord edited;
+    bool hasEdits;
+    {
+        std::lock_guard<std::mutex> lock( this->jobMutex );
+        file = this->worldFile;
+        auto it = this->evictedEdits.find( key );
+        hasEdits = it != this->evictedEdits.end();
+        if ( hasEdits ) {
+            edited = it->second;
+        }
+    }
+    Built built;
+    built.key = key;
+    this->buildChunk( built, file.get(), hasEdits ? &edited : NULL );
+    built.lod.reset( new ChunkLod( this->len ) );
+    built.lod->bake( *built.chunk );
+    this->insertBuilt( built );
+    return &this->cache[ key ];
+}
+void ChunkManager::buildChunk( Built& built, WorldFile* file, EditedRecord* edited )
+{
+    // the tiles come from kept edits, else the world file, else the generator
+    ChunkKey key = built.key;
+    built.chunk.reset( new Chunk( this->len, key.x * this->len * TILE_W, key.y * this->len * TILE_H ) );
+    if ( edited != NULL && !this->readSpilled( *edited ) ) {
+        printf( "Unable to read the kept edits of chunk %d, %d!\n", key.x, key.y );
+        edited = NULL;
+    }
+    built.fromEdits = edited != NULL && decodeChunkRecord( edited->record.data(), edited->record.size(),
+                                                           edited->encoding, built.chunk->data(), this->len );
+    built.fromFile = !built.fromEdits && file != NULL && file->readChunk( key, *built.chunk );
+    if ( !built.fromEdits && !built.fromFile ) {
+        this->terrain.generate( *built.chunk, key.x * this->len, key.y * this->len );
+    }
+}
+void ChunkManager::generateNext()
+{
+    ChunkKey key;
+    std::shared_ptr<WorldFile> file;
+    EditedRecord edited;
+    bool hasEdits;
+    {
+        std::lock_guard<std::mutex> lock( this->jobMutex );
+        this->queuedJobs--;
+        if ( this->pending.empty() ) {
+            return;
+        }
+        key = this->pending.front();
+        this->pending.pop_front();
+        this->inFlight.insert( key );
+        file = this->worldFile;
+        auto it = this->evictedEdits.find( key );
+        hasEdits = it != this->evictedEdits.end();
+        if ( hasEdits ) {
+            edited = it->second;
+        }
+    }
+
+    PROFILE_ZONE( "generate chunk" );
+    std::shared_ptr<Built> built( new Built() );
+    built->key = key;
+    this->buildChunk( *built, file.get(), hasEdits ? &edited : NULL );
+
+    // the LOD image is baked by a follow-up job, which runs next on this
+    // worker unless an idle one steals it first. Its texture is created by the
+    // render thread the first time it is drawn
+    this->jobs.submit( [this, built]() {
+        PROFILE_ZONE( "bake lod" );
+        built->lod.reset( new ChunkLod( this->len ) );
+        built->lod->bake( *built->chunk );
+        std::lock_guard<std::mutex> lock( this->jobMutex );
+        this->finished.push_back( std::move( *built ) );
+    } );
+}
+bool ChunkManager::openWorld( const char* path )
+{
+    // chunks missing from the file are still generated
+    std::shared_ptr<WorldFile> file( new WorldFile() );
+    if ( !file->open( path ) ) {
+        return false;
+    }
+    if ( file->chunkLength() != this->len ) {
+        printf( "World file %s has %d tile chunks, expected %d!\n", path, file->chunkLength(), this->len );
+        return false;
+    }
+    std::lock_guard<std::mutex> lock( this->jobMutex );
+    this->worldFile = file;
+    return true;
+}
+bool ChunkManager::saveWorld( const char* path )
+{
+    // write every loaded chunk plus the chunks of the current world file that
+    // are not loaded. Only chunks whose tiles differ from their record in the
+    // file are encoded again; the others copy their record over. Unedited
+    // chunks are written without what the simulation changed in them, see
+    // simulate(). The file is written next to the old one and renamed over
+    // it, so workers reading the old mapping are not disturbed
+    PROFILE_ZONE( "save world" );
+    std::shared_ptr<WorldFile> file;
+    std::vector<ChunkKey> keys;
+    std::vector<EditedRecord> kept;
+    {
+        std::lock_guard<std::mutex> lock( this->jobMutex );
+        file = this->worldFile;
+        for ( auto it=this->evictedEdits.begin(); it!=this->evictedEdits.end(); it++ ) {
+            keys.push_back( it->first );
+            kept.push_back( it->second );
+        }
+    }
+    std::vector<std::vector<Uint8>> records;
+    std::vector<Uint32> encodings;
+    for ( size_t i=0; i<kept.size(); i++ ) {
+        if ( !this->readSpilled( kept[ i ] ) ) {
+            printf( "Unable to read the kept edits of chunk %d, %d!\n", keys[ i ].x, keys[ i ].y );
+            return false;
+        }
+        records.push_back( std::move( kept[ i ].record ) );
+        encodings.push_back( kept[ i ].encoding );
+    }
+    // encode the changed loaded chunks in parallel, then collect the records in order
+    std::vector<Entry*> encoded;
+    for ( auto it=this->cache.begin(); it!=this->cache.end(); it++ ) {
+        if ( it->second.modified || !it->second.fromFile || file == NULL ) {
+            keys.push_back( it->first );
+            encoded.push_back( &it->second );
+        }
+    }
+    size_t first = records.size();
+    records.resize( keys.size() );
+    encodings.resize( keys.size() );
+    JobGroup group;
+    for ( size_t i=first; i<keys.size(); i++ ) {
+        Entry* entry = encoded[ i - first ];
+        this->jobs.submit( [&, i, entry]() {
+            if ( entry->modified || entry->fromFile ) {
+                encodings[ i ] = encodeChunkRecord( entry->chunk->data(), this->len, records[ i ] );
+                return;
+            }
+            // generated again, as the simulation may have changed the tiles
+            Chunk generated( this->len );
+            this->terrain.generate( generated, keys[ i ].x * this->len, keys[ i ].y * this->len );
+            encodings[ i ] = encodeChunkRecord( generated.data(), this->len, records[ i ] );
+        }, &group );
+    }
+    this->jobs.wait( group );
+    WorldFileWriter writer( this->len );
+    std::unordered_set<ChunkKey, ChunkKeyHash> written;
+    for ( size_t i=0; i<keys.size(); i++ ) {
+        writer.addRecord( keys[ i ], records[ i ].data(), records[ i ].size(), encodings[ i ] );
+        written.insert( keys[ i ] );
+    }
+    for ( int i=0; file != NULL && i<file->chunkCount(); i++ ) {
+        const WorldFileIndexEntry& entry = file->entries()[ i ];
+        const Uint8* record = file->record( entry );
+        if ( record != NULL && written.count( { entry.x, entry.y } ) == 0 ) {
+            writer.addRecord( { entry.x, entry.y }, record, entry.size, entry.encoding );
+        }
+    }
+    std::string tmpPath = std::string( path ) + ".tmp";
+    if ( !writer.write( tmpPath.c_str() ) ) {
+        return false;
+    }
+    if ( rename( tmpPath.c_str(), path ) != 0 ) {
+        printf( "Unable to replace world file %s!\n", path );
+        return false;
+    }
+    if ( !this->openWorld( path ) ) {
+        return false;
+    }
+    // everything written is now in the file
+    for ( size_t i=0; i<encoded.size(); i++ ) {
+        encoded[ i ]->modified = false;
+        encoded[ i ]->fromFile = true;
+    }
+    for ( size_t i=0; i<first; i++ ) {
+        this->eraseKeptEdits( keys[ i ] );
+    }
+    return true;
+}
@@ -0,0 +1,165 @@
+#ifndef FERMI_WORLD_H
+#define FERMI_WORLD_H
+
+#include <list>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "common.h"
+#include "camera.h"
+#include "tile.h"
+#include "lod.h"
+#include "chunktexture.h"
+#include "worldfile.h"
+#include "terrain.h"
+#include "jobs.h"
+#include "tilesim.h"
+
+struct ChunkCacheStats {
+    long hits;
+    long misses;
+    long evictions;
+    long generated;
+    // chunks read from the world file or kept edits instead of generated
+    long loaded;
+    // edited chunks evicted with their tiles kept in memory
+    long keptEdits;
+    // kept edit records moved out of memory into the spill file
+    long spills;
+};
+
+// Streams an unbounded world made of square chunks. Chunks around the camera
+// are generated and baked as jobs and kept in an LRU cache bounded by a memory
+// cap; the render thread only ever touches chunks that are fully built, and
+// is the only one creating or updating textures.
+class ChunkManager {
+public:
+    ChunkManager( int chunkLength, int workers, size_t memoryCap, Uint32 seed );
+    ~ChunkManager();
+    void update( Camera& cam );
+    void render( Camera& cam );
+    void render( Camera& cam, TileBatch& batch );
+    bool render( Camera& cam, DrawList& list );
+    void renderCached( Camera& cam, TileBatch& batch );
+    void releaseTextures();
+    void invalidateTextures();
+    bool setTile( int tileX, int tileY, Uint8 type, Uint8* previous=NULL );
+    void simulate( TileSimulation& sim );
+    void takeChanges( std::vector<SDL_Rect>& rects );
+    Uint64 viewDigest( Camera& cam );
+    bool openWorld( const char* path );
+    bool saveWorld( const char* path );
+
+    int chunkLength() { return this->len; };
+    size_t chunkBytes();
+    // loaded chunks plus the kept edits of evicted ones that are still in
+    // memory, held to the memory cap
+    size_t memoryUsed() { return this->cache.size() * this->chunkBytes() + this->keptBytes; };
+    size_t keptEditBytes() { return this->keptBytes; };
+    int loadedChunks() { return this->cache.size(); };
+    int pendingChunks();
+    ChunkCacheStats& stats() { return this->counters; };
+    // the workers that stream chunks, for other per tick work to share
+    JobSystem& workers() { return this->jobs; };
+private:
+    // the tiles of an edited chunk that was evicted before it was saved
+    struct EditedRecord {
+        std::vector<Uint8> record;
+        Uint32 encoding;
+        // moved to the spill file: record is empty and its spillSize bytes
+        // are at spillOffset
+        bool spilled;
+        Uint32 spillSize;
+        Uint64 spillOffset;
+    };
+    // a chunk handed from the jobs to the render thread
+    struct Built {
+        ChunkKey key;
+        std::unique_ptr<Chunk> chunk;
+        std::unique_ptr<ChunkLod> lod;
+        // read from the world file instead of generated
+        bool fromFile;
+        // rebuilt from an EditedRecord
+        bool fromEdits;
+    };
+    struct Entry {
+        std::unique_ptr<Chunk> chunk;
+        std::unique_ptr<ChunkLod> lod;
+        ChunkTexture baked;
+        std::list<ChunkKey>::iterator lruPos;
+        int lastUsedFrame;
+        int lastDrawnFrame;
+        // the world file holds this chunk's tiles as they are now
+        bool fromFile;
+        // edited since it was loaded or saved, so its record has to be rewritten
+        bool modified;
+    };
+
+    void keyRange( const SDL_Rect& view, int margin, int& cx0, int& cx1, int& cy0, int& cy1 );
+    Entry* find( const ChunkKey& key );
+    void renderLod( Camera& cam );
+    void collectFinished();
+    void buildChunk( Built& built, WorldFile* file, EditedRecord* edited );
+    void insertBuilt( Built& built );
+    Entry* loadNow( const ChunkKey& key );
+    void evict();
+    void addChange( const SDL_Rect& rect );
+    void eraseKeptEdits( const ChunkKey& key );
+    void spillKeptEdits();
+    bool readSpilled( EditedRecord& edited );
+    void releaseUnusedTextures();
+    void generateNext();
+
+    int len;
+    size_t memoryCap;
+    int frame;
+    ChunkCacheStats counters;
+    // largest texture side the renderer supports, 0 until queried
+    int maxTextureSize;
+    // read only after construction, shared by the workers
+    const TerrainGenerator terrain;
+
+    // world rects whose tiles changed since takeChanges(): edited tiles and
+    // chunks that finished loading
+    std::vector<SDL_Rect> changes;
+
+    // every loaded chunk in the last simulation step, reused between steps
+    std::vector<SimChunk> simChunks;
+    std::vector<Entry*> simEntries;
+
+    // front of the list is the most recently used chunk
+    std::unordered_map<ChunkKey, Entry, ChunkKeyHash> cache;
+    std::list<ChunkKey> lru;
+
+    // shared with the jobs, guarded by jobMutex. Each queued generate job
+    // builds whichever pending chunk is nearest when it starts
+    std::mutex jobMutex;
+    std::deque<ChunkKey> pending;
+    std::unordered_set<ChunkKey, ChunkKeyHash> inFlight;
+    std::vector<Built> finished;
+    int queuedJobs;
+    // edits of evicted chunks, used instead of the world file or the generator
+    // when they are built again. Written to the world file on save
+    std::unordered_map<ChunkKey, EditedRecord, ChunkKeyHash> evictedEdits;
+    // memory held by evictedEdits. Only changed by the thread that owns the
+    // world, which reads it without the lock
+    size_t keptBytes;
+    // unnamed temporary file the records of evictedEdits are moved to when
+    // they outgrow their share of the cap. Records are appended at spillEnd
+    // and only read back with pread, so jobs read it without the lock. NULL
+    // if it could not be created
+    std::shared_ptr<FILE> spillFile;
+    Uint64 spillEnd;
+    // records in evictedEdits that are in the spill file, guarded by jobMutex
+    int spilledCount;
+    // replaced as a whole when the world is saved, so jobs keep their copy alive
+    std::shared_ptr<WorldFile> worldFile;
+    // last member, so its threads are joined before anything they use is destroyed
+    JobSystem jobs;
+};
+
+#endif
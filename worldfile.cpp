@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "worldfile.h"
+
+bool keyLess( const ChunkKey& a, const ChunkKey& b )
+{
+    // index order: rows of chunks top to bottom, then left to right
+    return a.y < b.y || ( a.y == b.y && a.x < b.x );
+}
+
+WorldFile::WorldFile()
+{
+    this->mapping = NULL;
+    this->mappingSize = 0;
+    this->header = NULL;
+    this->index = NULL;
+}
+WorldFile::~WorldFile()
+{
+    this->close();
+}
+void WorldFile::close()
+{
+    if ( this->mapping != NULL ) {
+        munmap( this->mapping, this->mappingSize );
+    }
+    this->mapping = NULL;
+    this->mappingSize = 0;
+    this->header = NULL;
+    this->index = NULL;
+}
+bool WorldFile::open( const char* path )
+{
+    // map the whole file without reading it; only the header and the index
+    // pages touched by lookups are loaded, so this does not depend on world size
+    this->close();
+    int fd = ::open( path, O_RDONLY );
+    if ( fd < 0 ) {
+        return false;
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 || (size_t)st.st_size < sizeof( WorldFileHeader ) ) {
+        printf( "World file %s is too small!\n", path );
+        ::close( fd );
+        return false;
+    }
+    void* mapping = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+    if ( mapping == MAP_FAILED ) {
+        printf( "Unable to map world file %s!\n", path );
+        return false;
+    }
+    this->mapping = mapping;
+    this->mappingSize = st.st_size;
+
+    const WorldFileHeader* header = (const WorldFileHeader*)mapping;
+    size_t indexEnd = sizeof( WorldFileHeader ) + (size_t)header->chunkCount * sizeof( WorldFileIndexEntry );
+    if ( header->magic != worldfile_constants::magic || header->version != worldfile_constants::version ) {
+        printf( "%s is not a version %u world file!\n", path, worldfile_constants::version );
+        this->close();
+        return false;
+    }
+    if ( header->chunkLength == 0 || indexEnd > this->mappingSize ) {
+        printf( "World file %s is truncated!\n", path );
+        this->close();
+        return false;
+    }
+    this->header = header;
+    this->index = (const WorldFileIndexEntry*)( (const Uint8*)mapping + sizeof( WorldFileHeader ) );
+    return true;
+}
+const WorldFileIndexEntry* WorldFile::find( const ChunkKey& key )
+{
+    // binary search in the sorted index
+    if ( this->header == NULL ) {
+        return NULL;
+    }
+    const WorldFileIndexEntry* first = this->index;
+    const WorldFileIndexEntry* last = this->index + this->header->chunkCount;
+    const WorldFileIndexEntry* it = std::lower_bound( first, last, key,
+        []( const WorldFileIndexEntry& e, const ChunkKey& k ) { return keyLess( { e.x, e.y }, k ); } );
+    if ( it == last || it->x != key.x || it->y != key.y ) {
+        return NULL;
+    }
+    return it;
+}
+const Uint8* WorldFile::record( const WorldFileIndexEntry& entry )
+{
+    if ( entry.offset > this->mappingSize || entry.size > this->mappingSize - entry.offset ) {
+        return NULL;
+    }
+    return (const Uint8*)this->mapping + entry.offset;
+}
+bool WorldFile::readChunk( const ChunkKey& key, Chunk& chunk )
+{
+    // decode the record of key into chunk. Returns false if the chunk is not in
+    // the file or its record is damaged
+    const WorldFileIndexEntry* entry = this->find( key );
+    if ( entry == NULL || chunk.length() != this->chunkLength() ) {
+        return false;
+    }
+    const Uint8* data = this->record( *entry );
+    if ( data == NULL ) {
+        return false;
+    }
+    return decodeChunkRecord( data, entry->size, entry->encoding, chunk.data(), chunk.length() );
+}
+
+bool decodeChunkRecord( const Uint8* record, Uint32 size, Uint32 encoding, Uint8* types, int chunkLength )
+{
+    size_t tiles = (size_t)chunkLength * chunkLength;
+    if ( encoding == worldfile_constants::encodingRaw ) {
+        if ( size != tiles ) {
+            return false;
+        }
+        memcpy( types, record, tiles );
+        return true;
+    }
+    if ( encoding == worldfile_constants::encodingRle ) {
+        // ( run length - 1, type ) pairs
+        size_t n = 0;
+        for ( Uint32 i=0; i+1<size; i+=2 ) {
+            size_t run = record[ i ] + 1;
+            if ( n + run > tiles ) {
+                return false;
+            }
+            memset( types + n, record[ i+1 ], run );
+            n += run;
+        }
+        return n == tiles;
+    }
+    return false;
+}
+
+Uint32 encodeChunkRecord( const Uint8* types, int chunkLength, std::vector<Uint8>& record )
+{
+    // run-length encode the chunk, falling back to raw bytes if that is smaller
+    size_t tiles = (size_t)chunkLength * chunkLength;
+    record.clear();
+    size_t i = 0;
+    while ( i < tiles && record.size() < tiles ) {
+        size_t run = 1;
+        while ( i + run < tiles && run < 256 && types[ i + run ] == types[ i ] ) {
+            run++;
+        }
+        record.push_back( run - 1 );
+        record.push_back( types[ i ] );
+        i += run;
+    }
+    if ( i == tiles && record.size() < tiles ) {
+        return worldfile_constants::encodingRle;
+    }
+    record.assign( types, types + tiles );
+    return worldfile_constants::encodingRaw;
+}
+
+WorldFileWriter::WorldFileWriter( int chunkLength )
+{
+    this->len = chunkLength;
+}
+void WorldFileWriter::add( const ChunkKey& key, const Uint8* types )
+{
+    std::vector<Uint8> record;
+    Uint32 encoding = encodeChunkRecord( types, this->len, record );
+    this->addRecord( key, record.data(), record.size(), encoding );
+}
+void WorldFileWriter::addRecord( const ChunkKey& key, const Uint8* record, Uint32 size, Uint32 encoding )
+{
+    size_t start = this->data.size();
+    this->data.insert( this->data.end(), record, record + size );
+    this->index.push_back( { key.x, key.y, start, size, encoding } );
+}
+bool WorldFileWriter::write( const char* path )
+{
+    // record offsets are kept relative to the data block until now
+    std::sort( this->index.begin(), this->index.end(),
+        []( const WorldFileIndexEntry& a, const WorldFileIndexEntry& b ) { return keyLess( { a.x, a.y }, { b.x, b.y } ); } );
+    Uint64 dataStart = sizeof( WorldFileHeader ) + this->index.size() * sizeof( WorldFileIndexEntry );
+    std::vector<WorldFileIndexEntry> entries( this->index );
+    for ( size_t i=0; i<entries.size(); i++ ) {
+        entries[ i ].offset += dataStart;
+    }
+    WorldFileHeader header = { worldfile_constants::magic, worldfile_constants::version,
+                               (Uint32)this->len, (Uint32)entries.size() };
+
+    FILE* f = fopen( path, "wb" );
+    if ( f == NULL ) {
+        printf( "Unable to open %s for writing!\n", path );
+        return false;
+    }
+    bool ok = fwrite( &header, sizeof( header ), 1, f ) == 1;
+    if ( !entries.empty() ) {
+        ok = ok && fwrite( entries.data(), sizeof( WorldFileIndexEntry ), entries.size(), f ) == entries.size();
+    }
+    if ( !this->data.empty() ) {
+        ok = ok && fwrite( this->data.data(), 1, this->data.size(), f ) == this->data.size();
+    }
+    ok = ( fclose( f ) == 0 ) && ok;
+    if ( !ok ) {
+        printf( "Unable to write world file %s!\n", path );
+    }
+    return ok;
+}
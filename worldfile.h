@@ -0,0 +1,83 @@
+#ifndef FERMI_WORLDFILE_H
+#define FERMI_WORLDFILE_H
+
+#include <vector>
+
+#include "common.h"
+#include "tile.h"
+
+// On-disk world: a fixed header, an index of chunk records sorted by chunk
+// coordinates, then the records themselves. Records hold the chunk's tile
+// types, either raw or run-length encoded. Files are written in native byte
+// order.
+//
+//   WorldFileHeader
+//   WorldFileIndexEntry[ chunkCount ]
+//   record data ...
+
+namespace worldfile_constants {
+    const Uint32 magic = 0x44575046;    // "FPWD"
+    const Uint32 version = 1;
+    const Uint32 encodingRaw = 0;
+    const Uint32 encodingRle = 1;
+};
+
+struct WorldFileHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 chunkLength;
+    Uint32 chunkCount;
+};
+
+struct WorldFileIndexEntry {
+    Sint32 x;
+    Sint32 y;
+    // from the start of the file
+    Uint64 offset;
+    Uint32 size;
+    Uint32 encoding;
+};
+
+// A world file mapped into memory. Opening only checks the header; chunk
+// records are paged in by the OS when a chunk is read. Reading is safe from
+// any number of threads
+class WorldFile {
+public:
+    WorldFile();
+    ~WorldFile();
+    bool open( const char* path );
+    void close();
+    bool readChunk( const ChunkKey& key, Chunk& chunk );
+    const WorldFileIndexEntry* find( const ChunkKey& key );
+    const Uint8* record( const WorldFileIndexEntry& entry );
+
+    int chunkLength() { return this->header != NULL ? this->header->chunkLength : 0; };
+    int chunkCount() { return this->header != NULL ? this->header->chunkCount : 0; };
+    const WorldFileIndexEntry* entries() { return this->index; };
+private:
+    void* mapping;
+    size_t mappingSize;
+    const WorldFileHeader* header;
+    const WorldFileIndexEntry* index;
+};
+
+// Encodes a chunk's tile types as a record, run-length encoded unless raw
+// bytes are smaller, and returns the encoding. Safe to call from any thread
+Uint32 encodeChunkRecord( const Uint8* types, int chunkLength, std::vector<Uint8>& record );
+// Decodes a record into a chunk's tile types. Returns false if it is damaged
+bool decodeChunkRecord( const Uint8* record, Uint32 size, Uint32 encoding, Uint8* types, int chunkLength );
+
+// Collects chunk records in memory and writes a complete world file
+class WorldFileWriter {
+public:
+    WorldFileWriter( int chunkLength );
+    void add( const ChunkKey& key, const Uint8* types );
+    void addRecord( const ChunkKey& key, const Uint8* record, Uint32 size, Uint32 encoding );
+    bool write( const char* path );
+private:
+    int len;
+    std::vector<WorldFileIndexEntry> index;
+    std::vector<Uint8> data;
+};
+
+#endif